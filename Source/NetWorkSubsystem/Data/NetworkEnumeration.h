@@ -18,6 +18,7 @@ enum class EGameState : uint8 {
 	EMultiplayerHost	UMETA(DisplayName = "Multiplayer Host"),
 	EMultiplayerInGame	UMETA(DisplayName = "Multiplayer In Game"),
 	ETravelling			UMETA(DisplayName = "Travelling"),
+	ENetworkError		UMETA(DisplayName = "Network Error"),
 };
 
 /* ENUM TO TRACK INPUT STATES */
@@ -26,4 +27,15 @@ enum class EInputMode : uint8 {
 	EUIOnly				UMETA(DisplayName = "UI Only"),
 	EUIAndGame			UMETA(DisplayName = "UI And Game"),
 	EGameOnly			UMETA(DisplayName = "Game Only"),
-};
\ No newline at end of file
+};
+
+/* ENUM FOR THE ASYNCHRONOUS SESSION OPERATIONS */
+UENUM(BlueprintType)
+enum class ESessionStage : uint8 {
+	ECreate				UMETA(DisplayName = "Create Session"),
+	EStart				UMETA(DisplayName = "Start Session"),
+	EFind				UMETA(DisplayName = "Find Sessions"),
+	EJoin				UMETA(DisplayName = "Join Session"),
+	EUpdate				UMETA(DisplayName = "Update Session"),
+	EDestroy			UMETA(DisplayName = "Destroy Session"),
+};
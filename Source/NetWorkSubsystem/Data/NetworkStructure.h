@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "OnlineSessionSettings.h"
+#include "NetWorkSubsystem/Data/NetworkEnumeration.h"
 #include "NetworkStructure.generated.h"
 /**
  * 
@@ -21,6 +22,104 @@ struct FBlueprintSessionSetting {
 };
 
 
+//one query preset for a multi-source search
+USTRUCT(BlueprintType)
+struct FBlueprintSearchSource {
+	GENERATED_BODY()
+
+	//name reported back in search results and source reports
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session Management")
+	FName SourceName;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session Management")
+	bool bIsLAN = false;
+
+	//online subsystem (or "Subsystem:Instance") to search with, None means the default one
+	//sources on the same subsystem instance run one after another, different instances run in parallel
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session Management")
+	FName SubsystemName;
+
+	//extra settings the found sessions must match
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session Management")
+	TArray<FBlueprintSessionSetting> QuerySettings;
+};
+
+//outcome of one source of a multi-source search
+USTRUCT(BlueprintType)
+struct FBlueprintSearchSourceReport {
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	FName SourceName;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	bool bHasFinished = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	bool bWasSuccessful = false;
+
+	//time from starting the query to its completion
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	float LatencyMs = -1.0f;
+
+	//results this source added to the merged list
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	int32 NumResults = 0;
+
+	//results this source found that were already in the merged list
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	int32 NumDuplicates = 0;
+};
+
+//states the player is likely to go to next from one state
+USTRUCT(BlueprintType)
+struct FBlueprintStateTransitions {
+	GENERATED_BODY()
+
+	//most likely first, widgets are preloaded in this order
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "State Manager")
+	TArray<EGameState> LikelyNextStates;
+};
+
+//bytes held by the network subsystem, see UNetWorkGameInstanceSubsystem::GetMemoryReport
+USTRUCT(BlueprintType)
+struct FBlueprintMemoryReport {
+	GENERATED_BODY()
+
+	//searchResults, SessionSearch and the queries of a multi-source search
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	int64 SearchResultBytes = 0;
+
+	//settings of the hosted or joined session, the warm pool and a pending fast join
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	int64 SessionSettingsBytes = 0;
+
+	//the cached widget classes and the widget on screen
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	int64 WidgetBytes = 0;
+
+	//delegates currently registered with the session interface or the game mode
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	int64 PendingDelegateBytes = 0;
+
+	//session trace ring buffer
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	int64 TraceBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	int64 TotalBytes = 0;
+
+	//largest TotalBytes seen since startup or the last reset
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	int64 HighWaterBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	int32 NumSearchResults = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	int32 NumPendingDelegates = 0;
+};
+
 USTRUCT(BlueprintType)
 struct FBlueprintSearchResult {
 	
@@ -28,6 +127,13 @@ struct FBlueprintSearchResult {
 	//Our search result. this type is not blueprint accessible
 	FOnlineSessionSearchResult result;
 
+	//online subsystem the result was found with, it has to be joined through the same one
+	FName SubsystemName;
+
+	//search source that found this result
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	FName SourceName;
+
 	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
 		FString ServerName;
 
@@ -7,34 +7,185 @@
 #include "Kismet/GameplayStatics.h"
 #include "Online.h"
 #include "Misc/Paths.h"
+#include "NetWorkSubsystem.h"
+#include "NetWorkSessionEmulator.h"
+#include "TimerManager.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+#include "GameFramework/GameMode.h"
+#include "GameFramework/GameSession.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "Misc/PackageName.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectHash.h"
+#include "Serialization/ArchiveCountMem.h"
+
+static FAutoConsoleCommandWithWorldAndArgs CmdDumpSessionTrace(
+	TEXT("net.SessionTrace.Dump"),
+	TEXT("Write the session trace ring buffer to Saved/SessionTraces."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+		UGameInstance *GameInstance = World ? World->GetGameInstance() : nullptr;
+		if (UNetWorkGameInstanceSubsystem *Subsystem = GameInstance ? GameInstance->GetSubsystem<UNetWorkGameInstanceSubsystem>() : nullptr) {
+			Subsystem->DumpSessionTrace();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs CmdSessionMemoryReport(
+	TEXT("net.SessionMemory.Report"),
+	TEXT("Log the bytes held by the network subsystem. Pass Reset to restart the high-water mark."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+		UGameInstance *GameInstance = World ? World->GetGameInstance() : nullptr;
+		if (UNetWorkGameInstanceSubsystem *Subsystem = GameInstance ? GameInstance->GetSubsystem<UNetWorkGameInstanceSubsystem>() : nullptr) {
+			if (Args.Num() > 0 && Args[0] == TEXT("Reset")) {
+				Subsystem->ResetMemoryHighWater();
+			}
+			Subsystem->LogMemoryReport();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs CmdSessionLifecycleBench(
+	TEXT("net.SessionLifecycle.Bench"),
+	TEXT("Time the per-call bookkeeping of session operations before and after caching the interfaces. Optional argument: iterations."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+		UGameInstance *GameInstance = World ? World->GetGameInstance() : nullptr;
+		if (UNetWorkGameInstanceSubsystem *Subsystem = GameInstance ? GameInstance->GetSubsystem<UNetWorkGameInstanceSubsystem>() : nullptr) {
+			Subsystem->RunLifecycleBenchmark(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100000);
+		}
+	}));
 
-UNetWorkGameInstanceSubsystem::UNetWorkGameInstanceSubsystem(const FObjectInitializer& ObjectInitializer)
+static TAutoConsoleVariable<int32> CVarSessionMemoryBudgetKB(
+	TEXT("net.SessionMemory.BudgetKB"),
+	0,
+	TEXT("Warn when the memory held by the network subsystem reaches a new high-water mark above this many KB, 0 disables the check."));
+
+//heap bytes behind one setting value, strings and blobs are the only ones that allocate
+static int64 GetSessionSettingDataSize(const FVariantData& Data)
 {
-	//initial state is None 
-	currentState = EGameState::ENone;
-	//current widget is nothing
-	currentWidget = nullptr;
-        
-	/* BIND FUNCTIONS FOR SESSION MANAGEMENT */
+	switch (Data.GetType()) {
+	case EOnlineKeyValuePairDataType::String:
+	case EOnlineKeyValuePairDataType::Json: {
+		FString Value;
+		Data.GetValue(Value);
+		return Value.GetAllocatedSize();
+	}
+	case EOnlineKeyValuePairDataType::Blob: {
+		TArray<uint8> Value;
+		Data.GetValue(Value);
+		return Value.GetAllocatedSize();
+	}
+	default:
+		return 0;
+	}
+}
+
+//heap bytes behind a settings object, not counting the object itself
+static int64 GetSessionSettingsSize(const FOnlineSessionSettings& Settings)
+{
+	int64 Bytes = Settings.Settings.GetAllocatedSize() + Settings.MemberSettings.GetAllocatedSize();
 
-	//Create
-	OnCreateSessionCompleteDelegate = FOnCreateSessionCompleteDelegate::CreateUObject(this, &UNetWorkGameInstanceSubsystem::OnCreateSessionComplete);
+	for (auto &setting : Settings.Settings) {
+		Bytes += GetSessionSettingDataSize(setting.Value.Data);
+	}
+	for (auto &member : Settings.MemberSettings) {
+		Bytes += member.Value.GetAllocatedSize();
+		for (auto &setting : member.Value) {
+			Bytes += GetSessionSettingDataSize(setting.Value.Data);
+		}
+	}
+	return Bytes;
+}
 
-	//Start
-	OnStartSessionCompleteDelegate = FOnStartSessionCompleteDelegate::CreateUObject(this, &UNetWorkGameInstanceSubsystem::OnStartOnlineGameComplete);
+//heap bytes behind a native search, its results included
+static int64 GetSessionSearchSize(const FOnlineSessionSearch& Search)
+{
+	int64 Bytes = sizeof(FOnlineSessionSearch) + Search.SearchResults.GetAllocatedSize() + Search.QuerySettings.SearchParams.GetAllocatedSize();
+
+	for (auto &result : Search.SearchResults) {
+		Bytes += GetSessionSettingsSize(result.Session.SessionSettings) + result.Session.OwningUserName.GetAllocatedSize();
+	}
+	return Bytes;
+}
 
-	//Find
-	OnFindSessionsCompleteDelegate = FOnFindSessionsCompleteDelegate::CreateUObject(this, &UNetWorkGameInstanceSubsystem::OnFindSessionsComplete);
+//object plus everything it owns, the way obj list counts it
+static int64 GetObjectSize(UObject* Object)
+{
+	if (!Object) {
+		return 0;
+	}
 
-	//Join
-	OnJoinSessionCompleteDelegate = FOnJoinSessionCompleteDelegate::CreateUObject(this, &UNetWorkGameInstanceSubsystem::OnJoinSessionComplete);
+	int64 Bytes = FArchiveCountMem(Object).GetMax();
 
-	//Update
-	OnUpdateSessionCompleteDelegate = FOnUpdateSessionCompleteDelegate::CreateUObject(this, &UNetWorkGameInstanceSubsystem::OnUpdateSessionComplete);
+	TArray<UObject*> Inner;
+	GetObjectsWithOuter(Object, Inner, true);
+	for (UObject *InnerObject : Inner) {
+		Bytes += FArchiveCountMem(InnerObject).GetMax();
+	}
+	return Bytes;
+}
 
-	//Destroy
-	OnDestroySessionCompleteDelegate = FOnDestroySessionCompleteDelegate::CreateUObject(this, &UNetWorkGameInstanceSubsystem::OnDestroySessionComplete);
+UNetWorkGameInstanceSubsystem::UNetWorkGameInstanceSubsystem(const FObjectInitializer& ObjectInitializer)
+{
+	//initial state is None 
+	currentState = EGameState::ENone;
+	//current widget is nothing
+	currentWidget = nullptr;
 
+	//nothing is being advertised yet
+	NumAdvertisementUpdatesSent = 0;
+	bAdvertisedInProgress = false;
+	publishedPlayerCount = 0;
+	bPublishedInProgress = false;
+	sentPlayerCount = 0;
+	bSentInProgress = false;
+	lastAdvertiseTime = 0.0;
+	bIsAdvertising = false;
+	bAdvertiseUpdateInFlight = false;
+
+	//default deadlines for each session operation
+	SessionStageTimeouts.Add(ESessionStage::ECreate, 15.0f);
+	SessionStageTimeouts.Add(ESessionStage::EStart, 15.0f);
+	SessionStageTimeouts.Add(ESessionStage::EFind, 30.0f);
+	SessionStageTimeouts.Add(ESessionStage::EJoin, 20.0f);
+	SessionStageTimeouts.Add(ESessionStage::EUpdate, 15.0f);
+	SessionStageTimeouts.Add(ESessionStage::EDestroy, 15.0f);
+	LastFailedSessionStage = ESessionStage::ECreate;
+
+	//no invite accepted yet
+	LastInviteToTravelMs = -1.0f;
+	inviteAcceptedTime = 0.0;
+
+	//not hosting or in a session yet
+	activeSessionName = GameSessionName;
+
+	//warm pool is empty until started
+	WarmPoolHits = 0;
+	WarmPoolMisses = 0;
+	LastWarmSessionTimeToReadyMs = 0.0f;
+	AverageWarmSessionTimeToReadyMs = 0.0f;
+	warmSessionCounter = 0;
+	numWarmSessionsReady = 0;
+	bWarmPoolActive = false;
+	warmMapPackage = nullptr;
+
+	//nothing measured yet
+	memoryHighWaterBytes = 0;
+
+	//default menu flow of the plugin widgets
+	WidgetPreloadHits = 0;
+	WidgetPreloadMisses = 0;
+	stateEnteredFrame = 0;
+	StateTransitions.Add(EGameState::EStartup).LikelyNextStates = { EGameState::EMainMenu };
+	StateTransitions.Add(EGameState::EMainMenu).LikelyNextStates = { EGameState::EMultiplayerHome };
+	StateTransitions.Add(EGameState::EMultiplayerHome).LikelyNextStates = { EGameState::EMultiplayerJoin, EGameState::EMultiplayerHost, EGameState::EMainMenu };
+	StateTransitions.Add(EGameState::EMultiplayerJoin).LikelyNextStates = { EGameState::ELoadingScreen, EGameState::EMultiplayerHome };
+	StateTransitions.Add(EGameState::EMultiplayerHost).LikelyNextStates = { EGameState::ELoadingScreen, EGameState::EMultiplayerHome };
+	StateTransitions.Add(EGameState::ENetworkError).LikelyNextStates = { EGameState::EMultiplayerHome };
+
+	//completion delegates are bound per session interface in Initialize
+	bFindingFriendSession = false;
 
 	//FPaths::ProjectPluginsDir()+TEXT("NetWorkSubsystem/Content/WBP/")+TEXT("JoinGameScreen/W_MultiplayerJoinGameMenu.W_MultiplayerJoinGameMenu_C'")
 	//FPaths::ProjectPluginsDir();
@@ -51,12 +202,81 @@ void UNetWorkGameInstanceSubsystem::Init()
 	cLoadingScreen = LoadClass<UUserWidget>(NULL, TEXT("WidgetBlueprint'/NetWorkSubsystem/WBP/W_LoadingScreen.W_LoadingScreen_C'"));
 }
 
+void UNetWorkGameInstanceSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	LLM_SCOPE_BYTAG(NetWorkSubsystem);
+	Super::Initialize(Collection);
+
+	//look the default interfaces up once, the completion delegates stay bound until Deinitialize
+	if (IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get()) {
+		cachedIdentity = OnlineSub->GetIdentityInterface();
+	}
+	IOnlineSessionPtr Sessions = GetSessions();
+
+	if (Sessions.IsValid()) {
+		//invites can be accepted at any time, listen for the whole lifetime of the subsystem
+		OnSessionUserInviteAcceptedDelegateHandle = Sessions->AddOnSessionUserInviteAcceptedDelegate_Handle(FOnSessionUserInviteAcceptedDelegate::CreateUObject(this, &UNetWorkGameInstanceSubsystem::OnSessionUserInviteAccepted));
+		OnFindFriendSessionCompleteDelegateHandle = Sessions->AddOnFindFriendSessionCompleteDelegate_Handle(0, FOnFindFriendSessionCompleteDelegate::CreateUObject(this, &UNetWorkGameInstanceSubsystem::OnFindFriendSessionComplete));
+	}
+
+	//widgets are preloaded a frame at a time for as long as the subsystem lives
+	preloadTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UNetWorkGameInstanceSubsystem::TickWidgetPreload), 0.0f);
+
+	//dedicated servers can turn the pool on without touching the game instance
+	if (FParse::Param(FCommandLine::Get(), TEXT("WarmSessionPool"))) {
+		bUseWarmSessionPool = true;
+	}
+
+	//the game session of a loaded map has to register players with the session we host
+	postLoadMapHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(this, &UNetWorkGameInstanceSubsystem::OnPostLoadMap);
+
+	//a lost connection or a failed travel leaves the session behind, and is worth a trace
+	if (GEngine) {
+		networkFailureHandle = GEngine->OnNetworkFailure().AddUObject(this, &UNetWorkGameInstanceSubsystem::HandleNetworkError);
+		travelFailureHandle = GEngine->OnTravelFailure().AddUObject(this, &UNetWorkGameInstanceSubsystem::HandleTravelError);
+	}
+
+	//the online subsystem may still be starting up, fill the pool on the first tick
+	if (bUseWarmSessionPool) {
+		if (UGameInstance *GameInstance = GetGameInstance()) {
+			GameInstance->GetTimerManager().SetTimerForNextTick(FTimerDelegate::CreateUObject(this, &UNetWorkGameInstanceSubsystem::StartWarmSessionPool));
+		}
+	}
+}
+
+void UNetWorkGameInstanceSubsystem::Deinitialize()
+{
+	StopAdvertisingSession();
+	StopWarmSessionPool();
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(postLoadMapHandle);
+	if (GEngine) {
+		GEngine->OnNetworkFailure().Remove(networkFailureHandle);
+		GEngine->OnTravelFailure().Remove(travelFailureHandle);
+	}
+	networkFailureHandle.Reset();
+	travelFailureHandle.Reset();
+
+	UnbindSessionInterfaces();
+	pendingSessionRequests.Empty();
+	cachedIdentity.Reset();
+
+	FTSTicker::GetCoreTicker().RemoveTicker(preloadTickerHandle);
+	preloadQueue.Empty();
+	preloadedWidgets.Empty();
+
+	Super::Deinitialize();
+}
+
 void UNetWorkGameInstanceSubsystem::ChangeState(EGameState newState)
 {
+	sessionTrace.Record(ENetWorkTraceEventType::EStateChange, (uint8)newState, 0, (int32)currentState);
+
 	Init();
 	if (newState != currentState) {
 		LeaveState();
 		EnterState(newState);
+		UpdateMemoryHighWater();
+		PublishSessionSnapshot();
 	}
 }
 
@@ -69,11 +289,16 @@ void UNetWorkGameInstanceSubsystem::SetInputMode(EInputMode newInputMode, bool b
 {
 	switch (newInputMode) {
 	case EInputMode::EUIOnly: {
-			GetWorld()->GetFirstPlayerController()->SetInputMode(FInputModeUIOnly());
+			//a dedicated server has no player controller
+			if (GetWorld()->GetFirstPlayerController()) {
+				GetWorld()->GetFirstPlayerController()->SetInputMode(FInputModeUIOnly());
+			}
 			break;
 	}
 	case EInputMode::EUIAndGame: {
-			GetWorld()->GetFirstPlayerController()->SetInputMode(FInputModeGameAndUI());
+			if (GetWorld()->GetFirstPlayerController()) {
+				GetWorld()->GetFirstPlayerController()->SetInputMode(FInputModeGameAndUI());
+			}
 			break;
 	}
 	case EInputMode::EGameOnly:
@@ -85,361 +310,1842 @@ void UNetWorkGameInstanceSubsystem::SetInputMode(EInputMode newInputMode, bool b
 			break;
 		}
 	}
-	
-	if ( GetWorld()->GetFirstPlayerController())
-	{
-		GetWorld()->GetFirstPlayerController()->bShowMouseCursor = bShowMouseCursor;
+	
+	if ( GetWorld()->GetFirstPlayerController())
+	{
+		GetWorld()->GetFirstPlayerController()->bShowMouseCursor = bShowMouseCursor;
+	}
+	CurrentInputMode = newInputMode;
+	bIsShowingMouseCursor = bShowMouseCursor;
+}
+
+void UNetWorkGameInstanceSubsystem::HostGame(bool bIsLAN, int32 MaxNumPlayers,
+	TArray<FBlueprintSessionSetting> sessionSettings)
+{
+	LLM_SCOPE_BYTAG(NetWorkSubsystem_SessionSettings);
+
+	//if the session interface is valid
+	if (GetSessions().IsValid()) {
+		//get unique player id, we use 0 since we dont allow multiple players per client
+		TSharedPtr<const FUniqueNetId> pid = GetLocalPlayerId();
+
+		//create the special settings map
+		TMap<FString, FOnlineSessionSetting> SpecialSettings = TMap<FString, FOnlineSessionSetting>();
+
+		//loop through any provided settings and add them to special settings map
+		for (auto &setting : sessionSettings) {
+			//create a new setting
+			FOnlineSessionSetting newSetting;
+
+			//set its data to the provided value
+			newSetting.Data = setting.value;
+
+			//ensure the setting is advertised over the network
+			newSetting.AdvertisementType = EOnlineDataAdvertisementType::ViaOnlineService;
+
+			//add setting to the map with the specified key
+			SpecialSettings.Add(setting.key, newSetting);
+		}
+
+		//Change the state to loading screen while attempting to host the game
+		ChangeState(EGameState::ELoadingScreen);
+
+		//a session created ahead of time only has to be started
+		if (TryHostFromWarmPool(bIsLAN, MaxNumPlayers, SpecialSettings)) {
+			return;
+		}
+
+		//host the session
+		HostSession(pid, GameSessionName, bIsLAN, MaxNumPlayers, SpecialSettings);
+	}
+}
+
+bool UNetWorkGameInstanceSubsystem::HostSession(TSharedPtr<const FUniqueNetId> UserId, FName SessionName, bool bIsLAN,
+	int32 MaxNumPlayers, TMap<FString, FOnlineSessionSetting> SettingsMap)
+{
+        IOnlineSessionPtr Sessions = GetSessions();
+
+        //a dedicated server has no local player, it hosts as player 0 like the warm pool and the engine's own game session do
+        const bool bHostAsPlayerNum = !UserId.IsValid() && IsRunningDedicatedServer();
+
+        if (Sessions.IsValid() && (UserId.IsValid() || bHostAsPlayerNum)) {
+                //hosted sessions always live on the default subsystem
+                sessionSubsystemName = NAME_None;
+                activeSessionName = SessionName;
+
+                SessionSettings = MakeShareable(new FOnlineSessionSettings(MakeHostSessionSettings(bIsLAN, MaxNumPlayers, SettingsMap)));
+                AddSessionRequest(ESessionStage::ECreate, ESessionRequestOwner::EHostGame, SessionName, NAME_None);
+
+                //without this the loading screen would wait for a callback that may never come
+                //armed before the call, the NULL subsystem completes inside it and disarms it there
+                ArmStageDeadline(ESessionStage::ECreate);
+                TraceSessionCall(ESessionStage::ECreate);
+                const bool bCreated = bHostAsPlayerNum
+                        ? FNetWorkSessionEmulator(Sessions).CreateSession(0, SessionName, *SessionSettings)
+                        : FNetWorkSessionEmulator(Sessions).CreateSession(*UserId, SessionName, *SessionSettings);
+                TraceSessionCallResult(ESessionStage::ECreate, bCreated, SessionName, NAME_None);
+
+                if (!bCreated) {
+                        FailSessionStage(ESessionStage::ECreate, TEXT("CreateSession was rejected"));
+                }
+                return bCreated;
+        }
+        FailSessionStage(ESessionStage::ECreate, TEXT("No online subsystem or user to host with"));
+        return false;
+}
+
+FOnlineSessionSettings UNetWorkGameInstanceSubsystem::MakeHostSessionSettings(bool bIsLAN, int32 MaxNumPlayers,
+	const TMap<FString, FOnlineSessionSetting>& SettingsMap)
+{
+	FOnlineSessionSettings Settings;
+	Settings.bIsLANMatch = bIsLAN;
+	Settings.bUsesPresence = true;
+	Settings.NumPublicConnections = MaxNumPlayers;
+	Settings.NumPrivateConnections = 0;
+	Settings.bAllowInvites = true;
+	Settings.bAllowJoinInProgress = true;
+	Settings.bShouldAdvertise = true;
+	Settings.bAllowJoinViaPresence = true;
+	Settings.bAllowJoinViaPresenceFriendsOnly = false;
+
+	Settings.Set(SETTING_MAPNAME, FString("Map_SandBox"), EOnlineDataAdvertisementType::ViaOnlineService);
+
+	for (auto &setting : SettingsMap) {
+		Settings.Settings.Add(FName(*setting.Key), setting.Value);
+	}
+	return Settings;
+}
+
+void UNetWorkGameInstanceSubsystem::OnCreateSessionComplete(FName SessionName, bool bWasSuccessful)
+{
+	TraceSessionCallback(ESessionStage::ECreate, bWasSuccessful);
+	DisarmStageDeadline(ESessionStage::ECreate);
+
+	if (!bWasSuccessful) {
+		FailSessionStage(ESessionStage::ECreate, TEXT("CreateSession failed"));
+		return;
+	}
+
+	//readers see the hosted session as soon as it exists, the state does not change until it has started
+	PublishSessionSnapshot();
+	StartHostedSession(SessionName);
+}
+
+void UNetWorkGameInstanceSubsystem::StartHostedSession(FName SessionName)
+{
+	IOnlineSessionPtr Sessions = GetSessions();
+
+	if (Sessions.IsValid()) {
+		AddSessionRequest(ESessionStage::EStart, ESessionRequestOwner::EHostGame, SessionName, NAME_None);
+		ArmStageDeadline(ESessionStage::EStart);
+
+		TraceSessionCall(ESessionStage::EStart);
+		const bool bStarted = FNetWorkSessionEmulator(Sessions).StartSession(SessionName);
+		TraceSessionCallResult(ESessionStage::EStart, bStarted, SessionName, NAME_None);
+
+		if (!bStarted) {
+			FailSessionStage(ESessionStage::EStart, TEXT("StartSession was rejected"));
+		}
+	}
+}
+
+void UNetWorkGameInstanceSubsystem::OnStartOnlineGameComplete(FName SessionName, bool bWasSuccessful)
+{
+	TraceSessionCallback(ESessionStage::EStart, bWasSuccessful);
+	DisarmStageDeadline(ESessionStage::EStart);
+
+	if (bWasSuccessful) {
+		//keep the advertised player count and match state live from now on
+		StartAdvertisingSession();
+		PublishSessionSnapshot();
+
+		UGameplayStatics::OpenLevel(GetWorld(), "Map_SandBox", true, "listen");
+
+		ChangeState(EGameState::ETravelling);
+	}
+	else {
+		FailSessionStage(ESessionStage::EStart, TEXT("StartSession failed"));
+	}
+}
+
+void UNetWorkGameInstanceSubsystem::FindGames(bool bIsLAN)
+{
+	LLM_SCOPE_BYTAG(NetWorkSubsystem_SearchResults);
+	bHasFinishedSearchingForGames = false;
+	bSearchingForGames = false;
+	searchResults.Empty();
+
+	//drop any multi-source search, its late completions are ignored
+	searchSources.Empty();
+	searchSourceReports.Empty();
+	searchResultIndexById.Empty();
+	CancelSearchRequests(ESessionRequestOwner::ESearchSource);
+
+	FindSessions(GetLocalPlayerId(), GameSessionName, bIsLAN);
+}
+
+void UNetWorkGameInstanceSubsystem::FindSessions(TSharedPtr<const FUniqueNetId> UserId, FName SessionName, bool bIsLAN)
+{
+	IOnlineSessionPtr Sessions = GetSessions();
+
+	if (Sessions.IsValid()) {
+		if (UserId.IsValid()) {
+			SessionSearch = MakeShareable(new FOnlineSessionSearch());
+			SessionSearch->bIsLanQuery = bIsLAN;
+			SessionSearch->MaxSearchResults = 100000000;
+			SessionSearch->PingBucketSize = 50;
+			SessionSearch->QuerySettings.Set(SEARCH_PRESENCE, true, EOnlineComparisonOp::Equals);
+
+			TSharedRef<FOnlineSessionSearch> SearchSettingsRef = SessionSearch.ToSharedRef();
+
+			AddSessionRequest(ESessionStage::EFind, ESessionRequestOwner::EFindGames, NAME_None, NAME_None);
+
+			bSearchingForGames = true;
+			ArmStageDeadline(ESessionStage::EFind);
+
+			TraceSessionCall(ESessionStage::EFind);
+			const bool bSearchStarted = FNetWorkSessionEmulator(Sessions).FindSessions(*UserId, SearchSettingsRef);
+			TraceSessionCallResult(ESessionStage::EFind, bSearchStarted, NAME_None, NAME_None);
+
+			if (!bSearchStarted) {
+				FailSessionStage(ESessionStage::EFind, TEXT("FindSessions was rejected"));
+			}
+		}
+	}
+	else {
+		OnFindSessionsComplete(false);
+	}
+}
+
+void UNetWorkGameInstanceSubsystem::OnFindSessionsComplete(bool bWasSuccessful)
+{
+	LLM_SCOPE_BYTAG(NetWorkSubsystem_SearchResults);
+	TraceSessionCallback(ESessionStage::EFind, bWasSuccessful, SessionSearch.IsValid() ? SessionSearch->SearchResults.Num() : 0);
+	DisarmStageDeadline(ESessionStage::EFind);
+
+	if (bWasSuccessful) {
+		FNetWorkSessionEmulator::InflateSearchResults(*SessionSearch);
+
+		for (auto &result : SessionSearch->SearchResults) {
+			FBlueprintSearchResult newresult = FBlueprintSearchResult(result);
+			searchResults.Add(newresult);
+		}
+	}
+
+	bHasFinishedSearchingForGames = true;
+	bSearchingForGames = false;
+
+	UpdateMemoryHighWater();
+	PublishSessionSnapshot();
+}
+
+void UNetWorkGameInstanceSubsystem::FindGamesMultiSource(bool bIncludeLAN, bool bIncludeOnline)
+{
+	TArray<FBlueprintSearchSource> Sources;
+
+	if (bIncludeLAN) {
+		FBlueprintSearchSource LANSource;
+		LANSource.SourceName = FName("LAN");
+		LANSource.bIsLAN = true;
+		LANSource.SubsystemName = LANSearchSubsystemName;
+
+		//run LAN on its own instance of the default subsystem so it does not wait for the online query
+		if (LANSource.SubsystemName == NAME_None) {
+			if (IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get()) {
+				LANSource.SubsystemName = FName(*(OnlineSub->GetSubsystemName().ToString() + TEXT(":LANSearch")));
+			}
+		}
+		Sources.Add(LANSource);
+	}
+
+	if (bIncludeOnline) {
+		FBlueprintSearchSource OnlineSource;
+		OnlineSource.SourceName = FName("Online");
+		OnlineSource.bIsLAN = false;
+		Sources.Add(OnlineSource);
+	}
+
+	FindGamesFromSources(Sources);
+}
+
+void UNetWorkGameInstanceSubsystem::FindGamesFromSources(TArray<FBlueprintSearchSource> Sources)
+{
+	LLM_SCOPE_BYTAG(NetWorkSubsystem_SearchResults);
+	searchResults.Empty();
+	searchResultIndexById.Empty();
+	searchSources.Empty();
+	searchSourceReports.Empty();
+
+	//a new search replaces whatever is still running, its late completions are dropped
+	CancelSearchRequests(ESessionRequestOwner::EFindGames);
+	CancelSearchRequests(ESessionRequestOwner::ESearchSource);
+
+	for (auto &source : Sources) {
+		FNetWorkSearchSourceState state;
+		state.Source = source;
+		state.SubsystemName = source.SubsystemName;
+
+		//fall back to the default subsystem if the requested instance cannot be created
+		if (state.SubsystemName != NAME_None && !IOnlineSubsystem::Get(state.SubsystemName)) {
+			state.SubsystemName = NAME_None;
+		}
+		searchSources.Add(state);
+
+		FBlueprintSearchSourceReport report;
+		report.SourceName = source.SourceName;
+		searchSourceReports.Add(report);
+	}
+
+	bHasFinishedSearchingForGames = searchSources.Num() == 0;
+	bSearchingForGames = !bHasFinishedSearchingForGames;
+
+	//one deadline covers the whole multi-source search
+	if (bSearchingForGames) {
+		ArmStageDeadline(ESessionStage::EFind);
+	}
+
+	StartPendingSearchSources();
+}
+
+void UNetWorkGameInstanceSubsystem::StartPendingSearchSources()
+{
+	for (int32 i = 0; i < searchSources.Num(); i++) {
+		FNetWorkSearchSourceState &state = searchSources[i];
+
+		if (state.bStarted) {
+			continue;
+		}
+
+		//a session interface only runs one search at a time, queue behind a running query on the same instance
+		bool bInstanceBusy = false;
+		for (auto &other : searchSources) {
+			if (other.bStarted && !other.bFinished && other.SubsystemName == state.SubsystemName) {
+				bInstanceBusy = true;
+				break;
+			}
+		}
+		if (bInstanceBusy) {
+			continue;
+		}
+
+		state.bStarted = true;
+		state.StartTime = FPlatformTime::Seconds();
+
+		IOnlineSessionPtr Sessions = GetSessions(state.SubsystemName);
+
+		if (!Sessions.IsValid()) {
+			MergeSearchSourceResults(i, false);
+			continue;
+		}
+
+		state.Search = MakeShareable(new FOnlineSessionSearch());
+		state.Search->bIsLanQuery = state.Source.bIsLAN;
+		state.Search->MaxSearchResults = 100000000;
+		state.Search->PingBucketSize = 50;
+		state.Search->QuerySettings.Set(SEARCH_PRESENCE, true, EOnlineComparisonOp::Equals);
+
+		for (auto &setting : state.Source.QuerySettings) {
+			state.Search->QuerySettings.Set(FName(*setting.key), setting.value, EOnlineComparisonOp::Equals);
+		}
+
+		AddSessionRequest(ESessionStage::EFind, ESessionRequestOwner::ESearchSource, NAME_None, state.SubsystemName);
+
+		//the search does not need a logged in user, which secondary instances usually lack
+		TraceSessionCall(ESessionStage::EFind);
+		const bool bSearchStarted = FNetWorkSessionEmulator(Sessions).FindSessions(0, state.Search.ToSharedRef());
+		TraceSessionCallResult(ESessionStage::EFind, bSearchStarted, NAME_None, state.SubsystemName);
+
+		if (!bSearchStarted) {
+			RemoveSessionRequest(ESessionStage::EFind, NAME_None, state.SubsystemName);
+			MergeSearchSourceResults(i, false);
+		}
+	}
+}
+
+void UNetWorkGameInstanceSubsystem::OnSearchSourceComplete(bool bWasSuccessful, FName SubsystemName)
+{
+	for (int32 i = 0; i < searchSources.Num(); i++) {
+		FNetWorkSearchSourceState &state = searchSources[i];
+
+		if (!state.bStarted || state.bFinished || state.SubsystemName != SubsystemName) {
+			continue;
+		}
+
+		if (state.Search.IsValid() && state.Search->SearchState == EOnlineAsyncTaskState::InProgress) {
+			continue;
+		}
+
+		MergeSearchSourceResults(i, bWasSuccessful);
+	}
+
+	StartPendingSearchSources();
+}
+
+void UNetWorkGameInstanceSubsystem::MergeSearchSourceResults(int32 SourceIndex, bool bWasSuccessful)
+{
+	LLM_SCOPE_BYTAG(NetWorkSubsystem_SearchResults);
+
+	FNetWorkSearchSourceState &state = searchSources[SourceIndex];
+	FBlueprintSearchSourceReport &report = searchSourceReports[SourceIndex];
+
+	state.bFinished = true;
+	report.bHasFinished = true;
+	report.bWasSuccessful = bWasSuccessful && state.Search.IsValid() && state.Search->SearchState == EOnlineAsyncTaskState::Done;
+	report.LatencyMs = (float)((FPlatformTime::Seconds() - state.StartTime) * 1000.0);
+
+	if (state.Search.IsValid()) {
+		TraceSessionCallback(ESessionStage::EFind, report.bWasSuccessful, state.Search->SearchResults.Num());
+	}
+
+	if (report.bWasSuccessful) {
+		//inflated copies share a session id, so here they exercise the de-duplication rather than grow the list
+		FNetWorkSessionEmulator::InflateSearchResults(*state.Search);
+
+		for (auto &result : state.Search->SearchResults) {
+			if (!result.IsValid()) {
+				continue;
+			}
+
+			FBlueprintSearchResult newresult = FBlueprintSearchResult(result);
+			newresult.SubsystemName = state.SubsystemName;
+			newresult.SourceName = state.Source.SourceName;
+
+			//the same session can be found by several sources, keep the lowest ping
+			const FString SessionId = result.GetSessionIdStr();
+			if (int32 *existing = searchResultIndexById.Find(SessionId)) {
+				report.NumDuplicates++;
+				if (result.PingInMs >= 0 && (searchResults[*existing].PingInMs < 0 || result.PingInMs < searchResults[*existing].PingInMs)) {
+					searchResults[*existing] = newresult;
+				}
+				continue;
+			}
+
+			searchResultIndexById.Add(SessionId, searchResults.Add(newresult));
+			report.NumResults++;
+		}
+	}
+
+	//keep SessionSearch pointing at the latest native search for older callers
+	if (state.Search.IsValid()) {
+		SessionSearch = state.Search;
+	}
+
+	bool bAllFinished = true;
+	for (auto &other : searchSources) {
+		bAllFinished &= other.bFinished;
+	}
+
+	if (bAllFinished) {
+		bHasFinishedSearchingForGames = true;
+		bSearchingForGames = false;
+		DisarmStageDeadline(ESessionStage::EFind);
+	}
+
+	UpdateMemoryHighWater();
+	PublishSessionSnapshot();
+}
+
+void UNetWorkGameInstanceSubsystem::JoinGame(FBlueprintSearchResult result)
+{
+	TSharedPtr<const FUniqueNetId> pid = GetLocalPlayerId();
+
+	//results from a multi-source search have to be joined on the instance that found them
+	sessionSubsystemName = result.SubsystemName;
+
+	JoinSession(pid, GameSessionName, result.result);
+}
+
+bool UNetWorkGameInstanceSubsystem::JoinSession(TSharedPtr<const FUniqueNetId> UserId, FName SessionName,
+	const FOnlineSessionSearchResult& SearchResult)
+{
+	bool bSuccessful = false;
+
+	IOnlineSessionPtr Sessions = GetSessions(sessionSubsystemName);
+
+	if (Sessions.IsValid() && UserId.IsValid()) {
+		activeSessionName = SessionName;
+		AddSessionRequest(ESessionStage::EJoin, ESessionRequestOwner::EJoinGame, SessionName, sessionSubsystemName);
+		ArmStageDeadline(ESessionStage::EJoin);
+		TraceSessionCall(ESessionStage::EJoin);
+		bSuccessful = FNetWorkSessionEmulator(Sessions).JoinSession(*UserId, SessionName, SearchResult);
+		TraceSessionCallResult(ESessionStage::EJoin, bSuccessful, SessionName, sessionSubsystemName);
+	}
+
+	if (!bSuccessful) {
+		FailSessionStage(ESessionStage::EJoin, TEXT("JoinSession was rejected"));
+	}
+	return bSuccessful;
+}
+
+void UNetWorkGameInstanceSubsystem::OnJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result)
+{
+	TraceSessionCallback(ESessionStage::EJoin, Result == EOnJoinSessionCompleteResult::Success, (int32)Result);
+	DisarmStageDeadline(ESessionStage::EJoin);
+
+	if (Result != EOnJoinSessionCompleteResult::Success) {
+		FailSessionStage(ESessionStage::EJoin, FString::Printf(TEXT("JoinSession failed: %s"), LexToString(Result)));
+		return;
+	}
+
+	IOnlineSessionPtr Sessions = GetSessions(sessionSubsystemName);
+
+	if (Sessions.IsValid()) {
+		APlayerController *const PlayerController = GetWorld()->GetFirstPlayerController();//GetFirstLocalPlayerController();
+
+		FString TravelURL;
+
+		if (PlayerController && Sessions->GetResolvedConnectString(SessionName, TravelURL)) {
+			//fast join from an invite or presence, measure how long the player waited
+			if (inviteAcceptedTime > 0.0) {
+				LastInviteToTravelMs = (float)((FPlatformTime::Seconds() - inviteAcceptedTime) * 1000.0);
+				inviteAcceptedTime = 0.0;
+				UE_LOG(LogNetWorkSubsystem, Log, TEXT("Invite to travel took %.1f ms"), LastInviteToTravelMs);
+			}
+
+			//a fast join is already in ETravelling, ChangeState would not publish the joined session
+			PublishSessionSnapshot();
+
+			PlayerController->ClientTravel(TravelURL, ETravelType::TRAVEL_Absolute);
+			ChangeState(EGameState::ETravelling);
+			return;
+		}
+	}
+
+	//joined the session but have nowhere to travel to
+	FailSessionStage(ESessionStage::EJoin, TEXT("Could not resolve the connect string of the joined session"));
+}
+
+void UNetWorkGameInstanceSubsystem::OnSessionUserInviteAccepted(const bool bWasSuccessful, const int32 ControllerId,
+	FUniqueNetIdPtr UserId, const FOnlineSessionSearchResult& InviteResult)
+{
+	if (!bWasSuccessful || !InviteResult.IsValid()) {
+		UE_LOG(LogNetWorkSubsystem, Warning, TEXT("Accepted invite could not be resolved to a session"));
+		return;
+	}
+
+	inviteAcceptedTime = FPlatformTime::Seconds();
+	FastJoinSession(InviteResult);
+}
+
+void UNetWorkGameInstanceSubsystem::JoinFriendGame(FUniqueNetIdRepl FriendId)
+{
+	IOnlineSessionPtr Sessions = GetSessions();
+
+	if (Sessions.IsValid() && FriendId.IsValid()) {
+		inviteAcceptedTime = FPlatformTime::Seconds();
+
+		//the player is committed to joining, show that instead of a menu
+		ChangeState(EGameState::ETravelling);
+
+		//look up only the friend's session rather than searching for games
+		bFindingFriendSession = true;
+		ArmStageDeadline(ESessionStage::EJoin);
+
+		if (!Sessions->FindFriendSession(0, *FriendId)) {
+			FailSessionStage(ESessionStage::EJoin, TEXT("FindFriendSession was rejected"));
+		}
+	}
+}
+
+void UNetWorkGameInstanceSubsystem::OnFindFriendSessionComplete(int32 LocalUserNum, bool bWasSuccessful,
+	const TArray<FOnlineSessionSearchResult>& SearchResults)
+{
+	//the delegate stays bound, only answer a lookup we started
+	if (!bFindingFriendSession) {
+		return;
+	}
+	bFindingFriendSession = false;
+
+	if (bWasSuccessful && SearchResults.Num() > 0 && SearchResults[0].IsValid()) {
+		FastJoinSession(SearchResults[0]);
+	}
+	else {
+		FailSessionStage(ESessionStage::EJoin, TEXT("Friend is not in a joinable session"));
+	}
+}
+
+void UNetWorkGameInstanceSubsystem::FastJoinSession(const FOnlineSessionSearchResult& SearchResult)
+{
+	//straight to travelling, none of the menu states are needed on this path
+	ChangeState(EGameState::ETravelling);
+
+	IOnlineSessionPtr Sessions = GetSessions(sessionSubsystemName);
+
+	//still in a session, leave it first and join from OnDestroySessionComplete
+	if (Sessions.IsValid() && Sessions->GetNamedSession(activeSessionName)) {
+		pendingFastJoin = SearchResult;
+		LeaveGame();
+		return;
+	}
+
+	//invites and presence always come from the default subsystem
+	sessionSubsystemName = NAME_None;
+
+	JoinSession(GetLocalPlayerId(), GameSessionName, SearchResult);
+}
+
+FString UNetWorkGameInstanceSubsystem::GetSessionSpecialSettingString(FString key)
+{
+	IOnlineSessionPtr Sessions = GetSessions(sessionSubsystemName);
+
+	if (Sessions.IsValid()) {
+		FOnlineSessionSettings *settings = Sessions->GetSessionSettings(activeSessionName);
+
+		if (settings) {
+			if (settings->Settings.Contains(FName(*key))) {
+				FString value;
+				settings->Settings[FName(*key)].Data.GetValue(value);
+
+				return value;
+			}
+			else {
+				return FString("INVALID KEY");
+			}
+		}
+	}
+	else {
+		return FString("NO SESSION!");
+	}
+	return FString("NO ONLINE SUBSYSTEM");
+}
+
+void UNetWorkGameInstanceSubsystem::SetOrUpdateSessionSpecialSettingString(FBlueprintSessionSetting newSetting)
+{
+	LLM_SCOPE_BYTAG(NetWorkSubsystem_SessionSettings);
+	IOnlineSessionPtr Sessions = GetSessions(sessionSubsystemName);
+
+	if (Sessions.IsValid()) {
+		FOnlineSessionSettings *settings = Sessions->GetSessionSettings(activeSessionName);
+
+		if (settings) {
+			if (settings->Settings.Contains(FName(*newSetting.key))) {
+				
+				settings->Settings[FName(*newSetting.key)].Data = newSetting.value;
+			}
+			else { 
+				FOnlineSessionSetting setting;
+
+				setting.Data = newSetting.value;
+				setting.AdvertisementType = EOnlineDataAdvertisementType::ViaOnlineService;
+				
+				settings->Settings.Add(FName(*newSetting.key), setting);
+			}
+
+			AddSessionRequest(ESessionStage::EUpdate, ESessionRequestOwner::EUpdateSession, activeSessionName, sessionSubsystemName);
+			ArmStageDeadline(ESessionStage::EUpdate);
+
+			TraceSessionCall(ESessionStage::EUpdate);
+			const bool bUpdateSent = FNetWorkSessionEmulator(Sessions).UpdateSession(activeSessionName, *settings, true);
+			TraceSessionCallResult(ESessionStage::EUpdate, bUpdateSent, activeSessionName, sessionSubsystemName);
+
+			if (!bUpdateSent) {
+				DisarmStageDeadline(ESessionStage::EUpdate);
+				RemoveSessionRequest(ESessionStage::EUpdate, activeSessionName, sessionSubsystemName);
+			}
+
+			PublishSessionSnapshot();
+		}
+	}
+}
+
+void UNetWorkGameInstanceSubsystem::OnUpdateSessionComplete(FName SessionName, bool bWasSuccessful)
+{
+	TraceSessionCallback(ESessionStage::EUpdate, bWasSuccessful);
+	DisarmStageDeadline(ESessionStage::EUpdate);
+}
+
+void UNetWorkGameInstanceSubsystem::StartAdvertisingSession()
+{
+	if (bIsAdvertising) {
+		return;
+	}
+
+	bIsAdvertising = true;
+	advertisedPlayers.Empty();
+	bAdvertisedInProgress = false;
+
+	//the session was created with every public slot open and not in progress
+	publishedPlayerCount = 0;
+	bPublishedInProgress = false;
+	sentPlayerCount = 0;
+	bSentInProgress = false;
+	lastAdvertiseTime = FPlatformTime::Seconds();
+
+	advertiseLoginHandle = FGameModeEvents::GameModePostLoginEvent.AddUObject(this, &UNetWorkGameInstanceSubsystem::OnAdvertisedPlayerLogin);
+	advertiseLogoutHandle = FGameModeEvents::GameModeLogoutEvent.AddUObject(this, &UNetWorkGameInstanceSubsystem::OnAdvertisedPlayerLogout);
+	advertiseMatchStateHandle = FGameModeEvents::OnGameModeMatchStateSetEvent().AddUObject(this, &UNetWorkGameInstanceSubsystem::OnAdvertisedMatchStateSet);
+}
+
+void UNetWorkGameInstanceSubsystem::StopAdvertisingSession()
+{
+	if (!bIsAdvertising) {
+		return;
+	}
+
+	bIsAdvertising = false;
+	advertisedPlayers.Empty();
+
+	FGameModeEvents::GameModePostLoginEvent.Remove(advertiseLoginHandle);
+	FGameModeEvents::GameModeLogoutEvent.Remove(advertiseLogoutHandle);
+	FGameModeEvents::OnGameModeMatchStateSetEvent().Remove(advertiseMatchStateHandle);
+	advertiseLoginHandle.Reset();
+	advertiseLogoutHandle.Reset();
+	advertiseMatchStateHandle.Reset();
+
+	//an update still in flight is not waited for any more
+	CancelSessionRequests(ESessionStage::EUpdate, ESessionRequestOwner::EAdvertise);
+	bAdvertiseUpdateInFlight = false;
+
+	if (UGameInstance *GameInstance = GetGameInstance()) {
+		GameInstance->GetTimerManager().ClearTimer(advertiseTimerHandle);
+		GameInstance->GetTimerManager().ClearTimer(advertiseDeadlineHandle);
+	}
+}
+
+void UNetWorkGameInstanceSubsystem::OnAdvertisedPlayerLogin(AGameModeBase* GameMode, APlayerController* NewPlayer)
+{
+	//the game mode events fire for every world in the process, PIE instances included
+	if (!GameMode || GameMode->GetGameInstance() != GetGameInstance()) {
+		return;
+	}
+
+	if (NewPlayer) {
+		advertisedPlayers.Add(NewPlayer);
+		RequestAdvertisementUpdate();
+	}
+}
+
+void UNetWorkGameInstanceSubsystem::OnAdvertisedPlayerLogout(AGameModeBase* GameMode, AController* Exiting)
+{
+	if (!GameMode || GameMode->GetGameInstance() != GetGameInstance()) {
+		return;
+	}
+
+	if (Exiting) {
+		advertisedPlayers.Remove(Exiting);
+		RequestAdvertisementUpdate();
+	}
+}
+
+void UNetWorkGameInstanceSubsystem::OnAdvertisedMatchStateSet(FName MatchState)
+{
+	//the event does not say which game mode changed, only follow it when it is the one of our world
+	UWorld *World = GetWorld();
+	AGameMode *GameMode = World ? World->GetAuthGameMode<AGameMode>() : nullptr;
+	if (!GameMode || GameMode->GetMatchState() != MatchState) {
+		return;
+	}
+
+	bAdvertisedInProgress = (MatchState == MatchState::InProgress);
+	RequestAdvertisementUpdate();
+}
+
+int32 UNetWorkGameInstanceSubsystem::GetLivePlayerCount()
+{
+	//controllers from a previous world may have been destroyed without a logout
+	for (auto It = advertisedPlayers.CreateIterator(); It; ++It) {
+		if (!It->IsValid()) {
+			It.RemoveCurrent();
+		}
+	}
+	return advertisedPlayers.Num();
+}
+
+void UNetWorkGameInstanceSubsystem::RequestAdvertisementUpdate()
+{
+	if (!bIsAdvertising) {
+		return;
+	}
+
+	//readers see the live count straight away, the backend only when the update goes out
+	PublishSessionSnapshot();
+
+	UGameInstance *GameInstance = GetGameInstance();
+	if (!GameInstance) {
+		return;
+	}
+	FTimerManager &TimerManager = GameInstance->GetTimerManager();
+	TimerManager.ClearTimer(advertiseTimerHandle);
+
+	//only one update at a time, OnAdvertisementUpdated calls back in here
+	if (bAdvertiseUpdateInFlight) {
+		return;
+	}
+
+	IOnlineSessionPtr Sessions = GetSessions();
+	FNamedOnlineSession *NamedSession = Sessions.IsValid() ? Sessions->GetNamedSession(activeSessionName) : nullptr;
+	if (!NamedSession) {
+		return;
+	}
+
+	const int32 MaxPlayers = NamedSession->SessionSettings.NumPublicConnections;
+	const int32 LivePlayers = GetLivePlayerCount();
+
+	//a join and a leave inside the same window cancel out
+	if (LivePlayers == publishedPlayerCount && bAdvertisedInProgress == bPublishedInProgress) {
+		return;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	const double SinceLastUpdate = Now - lastAdvertiseTime;
+
+	//small player count changes wait until they are stale, everything else only waits for the minimum interval
+	const bool bFullChanged = (LivePlayers >= MaxPlayers) != (publishedPlayerCount >= MaxPlayers);
+	const bool bSignificant = bAdvertisedInProgress != bPublishedInProgress
+		|| bFullChanged
+		|| FMath::Abs(LivePlayers - publishedPlayerCount) >= AdvertisePlayerHysteresis;
+	const double RequiredInterval = bSignificant ? AdvertiseMinUpdateInterval : FMath::Max(AdvertiseMinUpdateInterval, AdvertiseMaxStaleInterval);
+
+	if (SinceLastUpdate >= RequiredInterval) {
+		PublishAdvertisement();
+	}
+	else {
+		TimerManager.SetTimer(advertiseTimerHandle, this, &UNetWorkGameInstanceSubsystem::RequestAdvertisementUpdate, RequiredInterval - SinceLastUpdate, false);
+	}
+}
+
+void UNetWorkGameInstanceSubsystem::PublishAdvertisement()
+{
+	IOnlineSessionPtr Sessions = GetSessions();
+
+	if (Sessions.IsValid()) {
+		FNamedOnlineSession *NamedSession = Sessions->GetNamedSession(activeSessionName);
+
+		if (NamedSession) {
+			const int32 MaxPlayers = NamedSession->SessionSettings.NumPublicConnections;
+			const int32 LivePlayers = GetLivePlayerCount();
+
+			//FBlueprintSearchResult reads CurrentPlayers from the open public connections
+			NamedSession->NumOpenPublicConnections = FMath::Clamp(MaxPlayers - LivePlayers, 0, MaxPlayers);
+			NamedSession->SessionSettings.Set(FName("InProgress"), bAdvertisedInProgress ? FString("true") : FString("false"), EOnlineDataAdvertisementType::ViaOnlineService);
+
+			AddSessionRequest(ESessionStage::EUpdate, ESessionRequestOwner::EAdvertise, activeSessionName, NAME_None);
+
+			//published once the backend has accepted them
+			sentPlayerCount = LivePlayers;
+			bSentInProgress = bAdvertisedInProgress;
+			lastAdvertiseTime = FPlatformTime::Seconds();
+			bAdvertiseUpdateInFlight = true;
+			NumAdvertisementUpdatesSent++;
+
+			//same timeout as the EUpdate stage, but its own timer
+			const float Timeout = SessionStageTimeouts.FindRef(ESessionStage::EUpdate);
+			UGameInstance *GameInstance = GetGameInstance();
+			if (GameInstance && Timeout > 0.0f) {
+				GameInstance->GetTimerManager().SetTimer(advertiseDeadlineHandle, this, &UNetWorkGameInstanceSubsystem::OnAdvertiseDeadline, Timeout, false);
+			}
+
+			TraceSessionCall(ESessionStage::EUpdate);
+			const bool bUpdateSent = FNetWorkSessionEmulator(Sessions).UpdateSession(activeSessionName, NamedSession->SessionSettings, true);
+			TraceSessionCallResult(ESessionStage::EUpdate, bUpdateSent, activeSessionName, NAME_None);
+
+			if (!bUpdateSent) {
+				if (GameInstance) {
+					GameInstance->GetTimerManager().ClearTimer(advertiseDeadlineHandle);
+				}
+				bAdvertiseUpdateInFlight = false;
+				RetryAdvertisementUpdate();
+			}
+		}
+	}
+}
+
+void UNetWorkGameInstanceSubsystem::RetryAdvertisementUpdate()
+{
+	UGameInstance *GameInstance = GetGameInstance();
+
+	if (bIsAdvertising && GameInstance) {
+		//never straight away, a backend that refuses every update would be asked again in a loop
+		GameInstance->GetTimerManager().SetTimer(advertiseTimerHandle, this, &UNetWorkGameInstanceSubsystem::RequestAdvertisementUpdate, FMath::Max(AdvertiseMinUpdateInterval, 1.0f), false);
+	}
+}
+
+void UNetWorkGameInstanceSubsystem::OnAdvertisementUpdated(FName SessionName, bool bWasSuccessful)
+{
+	TraceSessionCallback(ESessionStage::EUpdate, bWasSuccessful);
+
+	if (UGameInstance *GameInstance = GetGameInstance()) {
+		GameInstance->GetTimerManager().ClearTimer(advertiseDeadlineHandle);
+	}
+	bAdvertiseUpdateInFlight = false;
+
+	//only values the backend accepted count as published, a failed update is sent again
+	if (bWasSuccessful) {
+		publishedPlayerCount = sentPlayerCount;
+		bPublishedInProgress = bSentInProgress;
+		RequestAdvertisementUpdate();
+	}
+	else {
+		RetryAdvertisementUpdate();
+	}
+}
+
+void UNetWorkGameInstanceSubsystem::OnAdvertiseDeadline()
+{
+	SessionStageTimeoutCounts.FindOrAdd(ESessionStage::EUpdate)++;
+
+	UE_LOG(LogNetWorkSubsystem, Warning, TEXT("Advertisement update did not complete within %.1f seconds"), SessionStageTimeouts.FindRef(ESessionStage::EUpdate));
+
+	//a late completion has nothing to route to any more
+	for (int32 i = pendingSessionRequests.Num() - 1; i >= 0; i--) {
+		if (pendingSessionRequests[i].Stage == ESessionStage::EUpdate && pendingSessionRequests[i].Owner == ESessionRequestOwner::EAdvertise) {
+			sessionTrace.Record(ENetWorkTraceEventType::ESessionAbandoned, (uint8)ESessionStage::EUpdate, 0, (int32)ENetWorkTraceAbandonReason::ETimedOut);
+			pendingSessionRequests.RemoveAt(i);
+		}
+	}
+
+	//the published values stay what the backend last accepted, send the live ones again
+	bAdvertiseUpdateInFlight = false;
+	RetryAdvertisementUpdate();
+}
+
+void UNetWorkGameInstanceSubsystem::LeaveGame()
+{
+	//the session is going away, stop advertising it
+	StopAdvertisingSession();
+
+	IOnlineSessionPtr Sessions = GetSessions(sessionSubsystemName);
+
+	if (Sessions.IsValid()) {
+		AddSessionRequest(ESessionStage::EDestroy, ESessionRequestOwner::ELeaveGame, activeSessionName, sessionSubsystemName);
+		ArmStageDeadline(ESessionStage::EDestroy);
+		TraceSessionCall(ESessionStage::EDestroy);
+		const bool bDestroying = FNetWorkSessionEmulator(Sessions).DestroySession(activeSessionName);
+		TraceSessionCallResult(ESessionStage::EDestroy, bDestroying, activeSessionName, sessionSubsystemName);
+
+		if (!bDestroying) {
+			FailSessionStage(ESessionStage::EDestroy, TEXT("DestroySession was rejected"));
+		}
+	}
+}
+
+void UNetWorkGameInstanceSubsystem::OnDestroySessionComplete(FName SessionName, bool bWasSuccessful)
+{
+	TraceSessionCallback(ESessionStage::EDestroy, bWasSuccessful);
+	DisarmStageDeadline(ESessionStage::EDestroy);
+
+	sessionSubsystemName = NAME_None;
+	activeSessionName = GameSessionName;
+	PublishSessionSnapshot();
+
+	//the match is over, have a session ready for the next one
+	RefillWarmPool();
+
+	//left the old session to accept an invite, join the new one instead of going back to the menu
+	if (pendingFastJoin.IsSet()) {
+		FOnlineSessionSearchResult FastJoinResult = pendingFastJoin.GetValue();
+		pendingFastJoin.Reset();
+		FastJoinSession(FastJoinResult);
+		return;
+	}
+
+	if (bWasSuccessful) {
+		UGameplayStatics::OpenLevel(GetWorld(), "Map_MainMenu", true);
+		ChangeState(EGameState::ETravelling);
+	}
+}
+
+void UNetWorkGameInstanceSubsystem::StartWarmSessionPool()
+{
+	bWarmPoolActive = true;
+
+	PreloadWarmPoolMap();
+	RefillWarmPool();
+}
+
+void UNetWorkGameInstanceSubsystem::StopWarmSessionPool()
+{
+	bWarmPoolActive = false;
+
+	if (UGameInstance *GameInstance = GetGameInstance()) {
+		GameInstance->GetTimerManager().ClearTimer(warmPoolRetryHandle);
+	}
+
+	//creates still in flight finish unanswered
+	CancelSessionRequests(ESessionStage::ECreate, ESessionRequestOwner::EWarmPool);
+
+	IOnlineSessionPtr Sessions = GetSessions();
+
+	if (Sessions.IsValid()) {
+		//sessions that were never handed out would stay registered with the backend
+		for (auto &warmSession : warmSessions) {
+			if (Sessions->GetNamedSession(warmSession.SessionName)) {
+				Sessions->DestroySession(warmSession.SessionName);
+			}
+		}
+	}
+	warmSessions.Empty();
+
+	warmMapPackage = nullptr;
+}
+
+float UNetWorkGameInstanceSubsystem::GetWarmPoolHitRate()
+{
+	const int32 NumRequests = WarmPoolHits + WarmPoolMisses;
+	return NumRequests > 0 ? (float)WarmPoolHits / (float)NumRequests : 0.0f;
+}
+
+int32 UNetWorkGameInstanceSubsystem::GetNumReadyWarmSessions()
+{
+	int32 NumReady = 0;
+	for (auto &warmSession : warmSessions) {
+		if (warmSession.bReady) {
+			NumReady++;
+		}
+	}
+	return NumReady;
+}
+
+void UNetWorkGameInstanceSubsystem::RefillWarmPool()
+{
+	LLM_SCOPE_BYTAG(NetWorkSubsystem_SessionSettings);
+	if (!bWarmPoolActive) {
+		return;
+	}
+
+	IOnlineSessionPtr Sessions = GetSessions();
+
+	//a dedicated process hosts one match, keep one session ready and none while a match is being hosted
+	if (!Sessions.IsValid() || warmSessions.Num() > 0 || Sessions->GetNamedSession(activeSessionName)) {
+		return;
+	}
+
+	const FOnlineSessionSettings Settings = MakeHostSessionSettings(bWarmPoolIsLAN, WarmPoolMaxPlayers, TMap<FString, FOnlineSessionSetting>());
+
+	//named apart from GameSessionName so a pool miss can host straight away while the unused one is destroyed
+	FNetWorkWarmSession warmSession;
+	warmSession.SessionName = FName(*FString::Printf(TEXT("WarmSession%d"), warmSessionCounter++));
+	warmSession.bIsLAN = bWarmPoolIsLAN;
+	warmSession.RequestTime = FPlatformTime::Seconds();
+	warmSessions.Add(warmSession);
+	AddSessionRequest(ESessionStage::ECreate, ESessionRequestOwner::EWarmPool, warmSession.SessionName, NAME_None);
+
+	//a dedicated server has no local player, host as player 0 like the engine's own game session does
+	TraceSessionCall(ESessionStage::ECreate);
+	const bool bCreated = FNetWorkSessionEmulator(Sessions).CreateSession(0, warmSession.SessionName, Settings);
+	TraceSessionCallResult(ESessionStage::ECreate, bCreated, warmSession.SessionName, NAME_None);
+
+	if (!bCreated) {
+		//try again later instead of spinning on a backend that refuses
+		RemoveSessionRequest(ESessionStage::ECreate, warmSession.SessionName, NAME_None);
+		warmSessions.Pop();
+		if (UGameInstance *GameInstance = GetGameInstance()) {
+			GameInstance->GetTimerManager().SetTimer(warmPoolRetryHandle, FTimerDelegate::CreateUObject(this, &UNetWorkGameInstanceSubsystem::RefillWarmPool), 5.0f, false);
+		}
+	}
+}
+
+void UNetWorkGameInstanceSubsystem::OnWarmSessionCreated(FName SessionName, bool bWasSuccessful)
+{
+	const int32 Index = warmSessions.IndexOfByPredicate([SessionName](const FNetWorkWarmSession& warmSession) { return warmSession.SessionName == SessionName; });
+
+	//the pool was stopped while it was being created
+	if (Index == INDEX_NONE) {
+		return;
+	}
+
+	TraceSessionCallback(ESessionStage::ECreate, bWasSuccessful);
+
+	if (!bWasSuccessful) {
+		UE_LOG(LogNetWorkSubsystem, Warning, TEXT("Could not create warm session %s, retrying"), *SessionName.ToString());
+		warmSessions.RemoveAt(Index);
+
+		if (UGameInstance *GameInstance = GetGameInstance()) {
+			GameInstance->GetTimerManager().SetTimer(warmPoolRetryHandle, FTimerDelegate::CreateUObject(this, &UNetWorkGameInstanceSubsystem::RefillWarmPool), 5.0f, false);
+		}
+		return;
+	}
+
+	FNetWorkWarmSession &warmSession = warmSessions[Index];
+	warmSession.bReady = true;
+
+	LastWarmSessionTimeToReadyMs = (float)((FPlatformTime::Seconds() - warmSession.RequestTime) * 1000.0);
+	numWarmSessionsReady++;
+	AverageWarmSessionTimeToReadyMs += (LastWarmSessionTimeToReadyMs - AverageWarmSessionTimeToReadyMs) / numWarmSessionsReady;
+
+	UE_LOG(LogNetWorkSubsystem, Log, TEXT("Warm session %s ready after %.1f ms"), *SessionName.ToString(), LastWarmSessionTimeToReadyMs);
+}
+
+bool UNetWorkGameInstanceSubsystem::TryHostFromWarmPool(bool bIsLAN, int32 MaxNumPlayers,
+	const TMap<FString, FOnlineSessionSetting>& SettingsMap)
+{
+	if (!bUseWarmSessionPool) {
+		return false;
+	}
+
+	IOnlineSessionPtr Sessions = GetSessions();
+
+	const bool bHit = warmSessions.Num() > 0 && warmSessions[0].bReady && warmSessions[0].bIsLAN == bIsLAN
+		&& Sessions.IsValid() && Sessions->GetNamedSession(warmSessions[0].SessionName);
+
+	if (!bHit) {
+		WarmPoolMisses++;
+		UE_LOG(LogNetWorkSubsystem, Log, TEXT("Warm pool miss, hit rate %.2f"), GetWarmPoolHitRate());
+
+		//the match is hosted the regular way, an unused pooled session would stay advertised next to it
+		if (UGameInstance *GameInstance = GetGameInstance()) {
+			GameInstance->GetTimerManager().ClearTimer(warmPoolRetryHandle);
+		}
+		CancelSessionRequests(ESessionStage::ECreate, ESessionRequestOwner::EWarmPool);
+		if (Sessions.IsValid()) {
+			for (auto &warmSession : warmSessions) {
+				if (Sessions->GetNamedSession(warmSession.SessionName)) {
+					Sessions->DestroySession(warmSession.SessionName);
+				}
+			}
+		}
+		warmSessions.Empty();
+		return false;
+	}
+
+	WarmPoolHits++;
+
+	//the session is ours now, the pool makes a new one once the match is over
+	sessionSubsystemName = NAME_None;
+	activeSessionName = warmSessions[0].SessionName;
+	warmSessions.Empty();
+
+	//the pool created it with default settings, apply what this match asked for and start it once that has landed
+	//one deadline covers the update and the start
+	SessionSettings = MakeShareable(new FOnlineSessionSettings(MakeHostSessionSettings(bIsLAN, MaxNumPlayers, SettingsMap)));
+	AddSessionRequest(ESessionStage::EUpdate, ESessionRequestOwner::EWarmPool, activeSessionName, NAME_None);
+	ArmStageDeadline(ESessionStage::EStart);
+
+	TraceSessionCall(ESessionStage::EUpdate);
+	const bool bUpdateSent = FNetWorkSessionEmulator(Sessions).UpdateSession(activeSessionName, *SessionSettings, true);
+	TraceSessionCallResult(ESessionStage::EUpdate, bUpdateSent, activeSessionName, NAME_None);
+
+	if (!bUpdateSent) {
+		FailSessionStage(ESessionStage::EStart, TEXT("UpdateSession of the pooled session was rejected"));
+	}
+
+	UE_LOG(LogNetWorkSubsystem, Log, TEXT("Warm pool hit, hit rate %.2f"), GetWarmPoolHitRate());
+	return true;
+}
+
+void UNetWorkGameInstanceSubsystem::OnWarmSessionUpdated(FName SessionName, bool bWasSuccessful)
+{
+	TraceSessionCallback(ESessionStage::EUpdate, bWasSuccessful);
+
+	if (!bWasSuccessful) {
+		FailSessionStage(ESessionStage::EStart, TEXT("UpdateSession of the pooled session failed"));
+		return;
+	}
+
+	StartHostedSession(SessionName);
+}
+
+void UNetWorkGameInstanceSubsystem::OnPostLoadMap(UWorld* LoadedWorld)
+{
+	if (!LoadedWorld || LoadedWorld->GetGameInstance() != GetGameInstance()) {
+		return;
+	}
+
+	//AGameSession registers players and starts and ends the match under its SessionName, which is GameSessionName
+	//unless told otherwise, a pooled session goes by its own name
+	AGameModeBase *GameMode = LoadedWorld->GetAuthGameMode();
+	IOnlineSessionPtr Sessions = GetSessions();
+	FNamedOnlineSession *NamedSession = Sessions.IsValid() ? Sessions->GetNamedSession(activeSessionName) : nullptr;
+
+	if (GameMode && GameMode->GameSession && NamedSession && NamedSession->bHosting) {
+		GameMode->GameSession->SessionName = activeSessionName;
+	}
+}
+
+void UNetWorkGameInstanceSubsystem::PreloadWarmPoolMap()
+{
+	if (warmMapPackage || WarmPoolMapName.IsEmpty()) {
+		return;
+	}
+
+	FString PackageName;
+	if (!FPackageName::SearchForPackageOnDisk(WarmPoolMapName, &PackageName)) {
+		UE_LOG(LogNetWorkSubsystem, Warning, TEXT("Warm pool map %s not found"), *WarmPoolMapName);
+		return;
+	}
+
+	//keep the map package referenced so OpenLevel finds it already in memory
+	LoadPackageAsync(PackageName, FLoadPackageAsyncDelegate::CreateWeakLambda(this, [this](const FName& LoadedName, UPackage* Package, EAsyncLoadingResult::Type Result) {
+		if (Result == EAsyncLoadingResult::Succeeded && bWarmPoolActive) {
+			warmMapPackage = Package;
+			UE_LOG(LogNetWorkSubsystem, Log, TEXT("Warm pool map %s loaded"), *LoadedName.ToString());
+		}
+	}));
+}
+
+void UNetWorkGameInstanceSubsystem::HandleNetworkError(UWorld* World, UNetDriver* NetDriver,
+	ENetworkFailure::Type FailureType, const FString& ErrorString)
+{
+	//the engine reports failures of every world, PIE instances included
+	if (World && World->GetGameInstance() != GetGameInstance()) {
+		return;
+	}
+
+	sessionTrace.Record(ENetWorkTraceEventType::ENetworkError, 0, 0, (int32)FailureType);
+	sessionTrace.DumpOnError(FString::Printf(TEXT("Network error %s: %s"), ENetworkFailure::ToString(FailureType), *ErrorString));
+
+	LeaveGame();
+}
+
+void UNetWorkGameInstanceSubsystem::HandleTravelError(UWorld* World, ETravelFailure::Type FailureType, const FString& ErrorString)
+{
+	if (World && World->GetGameInstance() != GetGameInstance()) {
+		return;
+	}
+
+	sessionTrace.Record(ENetWorkTraceEventType::ENetworkError, 1, 0, (int32)FailureType);
+	sessionTrace.DumpOnError(FString::Printf(TEXT("Travel error %s: %s"), ETravelFailure::ToString(FailureType), *ErrorString));
+
+	LeaveGame();
+}
+
+void UNetWorkGameInstanceSubsystem::ArmStageDeadline(ESessionStage Stage)
+{
+	const float *Timeout = SessionStageTimeouts.Find(Stage);
+	UGameInstance *GameInstance = GetGameInstance();
+
+	if (!GameInstance || !Timeout || *Timeout <= 0.0f) {
+		return;
+	}
+
+	FTimerDelegate DeadlineDelegate = FTimerDelegate::CreateUObject(this, &UNetWorkGameInstanceSubsystem::OnStageDeadline, Stage);
+	GameInstance->GetTimerManager().SetTimer(stageDeadlineHandles[(int32)Stage], DeadlineDelegate, *Timeout, false);
+}
+
+void UNetWorkGameInstanceSubsystem::DisarmStageDeadline(ESessionStage Stage)
+{
+	if (UGameInstance *GameInstance = GetGameInstance()) {
+		GameInstance->GetTimerManager().ClearTimer(stageDeadlineHandles[(int32)Stage]);
+	}
+}
+
+void UNetWorkGameInstanceSubsystem::OnStageDeadline(ESessionStage Stage)
+{
+	SessionStageTimeoutCounts.FindOrAdd(Stage)++;
+
+	UE_LOG(LogNetWorkSubsystem, Warning, TEXT("%s did not complete within %.1f seconds"), FNetWorkSessionTrace::GetStageName((uint8)Stage), SessionStageTimeouts.FindRef(Stage));
+
+	//the calls of the stage are the ones the player was stuck on, show them as timed out rather than cancelled
+	//an advertisement update runs on its own deadline
+	for (int32 i = pendingSessionRequests.Num() - 1; i >= 0; i--) {
+		if (pendingSessionRequests[i].Stage == Stage && pendingSessionRequests[i].Owner != ESessionRequestOwner::EAdvertise) {
+			sessionTrace.Record(ENetWorkTraceEventType::ESessionAbandoned, (uint8)Stage, 0, (int32)ENetWorkTraceAbandonReason::ETimedOut);
+			pendingSessionRequests.RemoveAt(i);
+		}
+	}
+
+	FailSessionStage(Stage, TEXT("Timed out"));
+}
+
+void UNetWorkGameInstanceSubsystem::FailSessionStage(ESessionStage Stage, const FString& Reason)
+{
+	DisarmStageDeadline(Stage);
+
+	LastFailedSessionStage = Stage;
+	LastSessionError = FString::Printf(TEXT("%s: %s"), FNetWorkSessionTrace::GetStageName((uint8)Stage), *Reason);
+
+	//the hosted session lives on the default subsystem, everything else on the one we joined through
+	const bool bHostStage = Stage == ESessionStage::ECreate || Stage == ESessionStage::EStart || Stage == ESessionStage::EUpdate;
+	IOnlineSessionPtr Sessions = GetSessions(bHostStage ? NAME_None : sessionSubsystemName);
+
+	switch (Stage) {
+	case ESessionStage::ECreate:
+	case ESessionStage::EStart:
+	case ESessionStage::EJoin: {
+		inviteAcceptedTime = 0.0;
+		pendingFastJoin.Reset();
+
+		//a late answer to the failed attempt must not restart it
+		bFindingFriendSession = false;
+		CancelSessionRequests(ESessionStage::ECreate, ESessionRequestOwner::EHostGame);
+		CancelSessionRequests(ESessionStage::EStart, ESessionRequestOwner::EHostGame);
+		CancelSessionRequests(ESessionStage::EUpdate, ESessionRequestOwner::EWarmPool);
+		CancelSessionRequests(ESessionStage::EJoin, ESessionRequestOwner::EJoinGame);
+
+		//a half created or joined session would block the next attempt
+		const FName failedSessionName = activeSessionName;
+		const FName failedSubsystemName = bHostStage ? NAME_None : sessionSubsystemName;
+		const bool bDestroyFailedSession = Sessions.IsValid() && Sessions->GetNamedSession(failedSessionName);
+		activeSessionName = GameSessionName;
+
+		StopAdvertisingSession();
+		ChangeState(EGameState::ENetworkError);
+
+		//the pool is refilled once the failed session is gone, straight away if there is none
+		if (bDestroyFailedSession) {
+			AddSessionRequest(ESessionStage::EDestroy, ESessionRequestOwner::EFailureCleanUp, failedSessionName, failedSubsystemName);
+			TraceSessionCall(ESessionStage::EDestroy);
+			const bool bDestroying = Sessions->DestroySession(failedSessionName);
+			TraceSessionCallResult(ESessionStage::EDestroy, bDestroying, failedSessionName, failedSubsystemName);
+
+			if (!bDestroying) {
+				RefillWarmPool();
+			}
+		}
+		else {
+			RefillWarmPool();
+		}
+		break;
+	}
+	case ESessionStage::EFind: {
+		//give up on every query that is still out, the single search or the sources of a multi-source one
+		CancelSearchRequests(ESessionRequestOwner::EFindGames);
+		CancelSearchRequests(ESessionRequestOwner::ESearchSource);
+
+		for (int32 i = 0; i < searchSources.Num(); i++) {
+			if (!searchSources[i].bFinished) {
+				searchSources[i].bStarted = true;
+				searchSources[i].bFinished = true;
+				searchSourceReports[i].bHasFinished = true;
+			}
+		}
+
+		//the search menu stays usable, it just shows what was found so far
+		bHasFinishedSearchingForGames = true;
+		bSearchingForGames = false;
+		break;
+	}
+	case ESessionStage::EUpdate: {
+		//an advertisement update in flight has its own deadline and is left alone
+		CancelSessionRequests(ESessionStage::EUpdate, ESessionRequestOwner::EUpdateSession);
+		break;
 	}
-	CurrentInputMode = newInputMode;
-	bIsShowingMouseCursor = bShowMouseCursor;
+	case ESessionStage::EDestroy: {
+		//an invite waiting for the old session to go away is dropped with it
+		inviteAcceptedTime = 0.0;
+		pendingFastJoin.Reset();
+
+		CancelSessionRequests(ESessionStage::EDestroy, ESessionRequestOwner::ELeaveGame);
+		sessionSubsystemName = NAME_None;
+		ChangeState(EGameState::ENetworkError);
+		break;
+	}
+	default:
+		break;
+	}
+
+	//written last so the file holds the cancelled calls and the error state as well
+	sessionTrace.DumpOnError(LastSessionError);
 }
 
-void UNetWorkGameInstanceSubsystem::HostGame(bool bIsLAN, int32 MaxNumPlayers,
-	TArray<FBlueprintSessionSetting> sessionSettings)
+IOnlineSessionPtr UNetWorkGameInstanceSubsystem::GetSessions(FName SubsystemName)
 {
-	//get the online subsystem
-	IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get();
-
-	//if OnlineSub is valid
-	if (OnlineSub) {
-		//get unique player id, we use 0 since we dont allow multiple players per client
-		TSharedPtr<const FUniqueNetId> pid = OnlineSub->GetIdentityInterface()->GetUniquePlayerId(0);
-
-		//create the special settings map
-		TMap<FString, FOnlineSessionSetting> SpecialSettings = TMap<FString, FOnlineSessionSetting>();
+	if (FNetWorkBoundSessionInterface *Bound = boundSessionInterfaces.Find(SubsystemName)) {
+		return Bound->Sessions;
+	}
 
-		//loop through any provided settings and add them to special settings map
-		for (auto &setting : sessionSettings) {
-			//create a new setting
-			FOnlineSessionSetting newSetting;
+	IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get(SubsystemName);
+	IOnlineSessionPtr Sessions = OnlineSub ? OnlineSub->GetSessionInterface() : IOnlineSessionPtr();
 
-			//set its data to the provided value
-			newSetting.Data = setting.value;
+	//not cached, an instance that comes up later is still picked up
+	if (!Sessions.IsValid()) {
+		return Sessions;
+	}
 
-			//ensure the setting is advertised over the network
-			newSetting.AdvertisementType = EOnlineDataAdvertisementType::ViaOnlineService;
+	//bind every completion once, the subsystem name tells the dispatchers which instance answered
+	FNetWorkBoundSessionInterface &Bound = boundSessionInterfaces.Add(SubsystemName);
+	Bound.Sessions = Sessions;
+	Bound.CreateHandle = Sessions->AddOnCreateSessionCompleteDelegate_Handle(FOnCreateSessionCompleteDelegate::CreateUObject(this, &UNetWorkGameInstanceSubsystem::HandleCreateSessionComplete, SubsystemName));
+	Bound.StartHandle = Sessions->AddOnStartSessionCompleteDelegate_Handle(FOnStartSessionCompleteDelegate::CreateUObject(this, &UNetWorkGameInstanceSubsystem::HandleStartSessionComplete, SubsystemName));
+	Bound.FindHandle = Sessions->AddOnFindSessionsCompleteDelegate_Handle(FOnFindSessionsCompleteDelegate::CreateUObject(this, &UNetWorkGameInstanceSubsystem::HandleFindSessionsComplete, SubsystemName));
+	Bound.JoinHandle = Sessions->AddOnJoinSessionCompleteDelegate_Handle(FOnJoinSessionCompleteDelegate::CreateUObject(this, &UNetWorkGameInstanceSubsystem::HandleJoinSessionComplete, SubsystemName));
+	Bound.UpdateHandle = Sessions->AddOnUpdateSessionCompleteDelegate_Handle(FOnUpdateSessionCompleteDelegate::CreateUObject(this, &UNetWorkGameInstanceSubsystem::HandleUpdateSessionComplete, SubsystemName));
+	Bound.DestroyHandle = Sessions->AddOnDestroySessionCompleteDelegate_Handle(FOnDestroySessionCompleteDelegate::CreateUObject(this, &UNetWorkGameInstanceSubsystem::HandleDestroySessionComplete, SubsystemName));
+
+	return Sessions;
+}
 
-			//add setting to the map with the specified key
-			SpecialSettings.Add(setting.key, newSetting);
+FUniqueNetIdPtr UNetWorkGameInstanceSubsystem::GetLocalPlayerId()
+{
+	if (!cachedIdentity.IsValid()) {
+		if (IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get()) {
+			cachedIdentity = OnlineSub->GetIdentityInterface();
 		}
+	}
 
-		//Change the state to loading screen while attempting to host the game
-		ChangeState(EGameState::ELoadingScreen);
+	//we use 0 since we dont allow multiple players per client
+	return cachedIdentity.IsValid() ? cachedIdentity->GetUniquePlayerId(0) : nullptr;
+}
 
-		//host the session
-		HostSession(pid, GameSessionName, bIsLAN, MaxNumPlayers, SpecialSettings);
+void UNetWorkGameInstanceSubsystem::UnbindSessionInterfaces()
+{
+	if (FNetWorkBoundSessionInterface *Default = boundSessionInterfaces.Find(NAME_None)) {
+		Default->Sessions->ClearOnSessionUserInviteAcceptedDelegate_Handle(OnSessionUserInviteAcceptedDelegateHandle);
+		Default->Sessions->ClearOnFindFriendSessionCompleteDelegate_Handle(0, OnFindFriendSessionCompleteDelegateHandle);
+	}
+	OnSessionUserInviteAcceptedDelegateHandle.Reset();
+	OnFindFriendSessionCompleteDelegateHandle.Reset();
+
+	for (auto &bound : boundSessionInterfaces) {
+		IOnlineSessionPtr Sessions = bound.Value.Sessions;
+
+		Sessions->ClearOnCreateSessionCompleteDelegate_Handle(bound.Value.CreateHandle);
+		Sessions->ClearOnStartSessionCompleteDelegate_Handle(bound.Value.StartHandle);
+		Sessions->ClearOnFindSessionsCompleteDelegate_Handle(bound.Value.FindHandle);
+		Sessions->ClearOnJoinSessionCompleteDelegate_Handle(bound.Value.JoinHandle);
+		Sessions->ClearOnUpdateSessionCompleteDelegate_Handle(bound.Value.UpdateHandle);
+		Sessions->ClearOnDestroySessionCompleteDelegate_Handle(bound.Value.DestroyHandle);
 	}
+	boundSessionInterfaces.Empty();
 }
 
-bool UNetWorkGameInstanceSubsystem::HostSession(TSharedPtr<const FUniqueNetId> UserId, FName SessionName, bool bIsLAN,
-	int32 MaxNumPlayers, TMap<FString, FOnlineSessionSetting> SettingsMap)
+void UNetWorkGameInstanceSubsystem::AddSessionRequest(ESessionStage Stage, ESessionRequestOwner Owner, FName SessionName, FName SubsystemName)
 {
-        IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get();
-
-        if (OnlineSub) {
-                IOnlineSessionPtr Sessions = OnlineSub->GetSessionInterface();
-                if (Sessions.IsValid() && UserId.IsValid()) {
-                        SessionSettings = MakeShareable(new FOnlineSessionSettings());
-                        SessionSettings->bIsLANMatch = bIsLAN;
-                        SessionSettings->bUsesPresence = true;
-                        SessionSettings->NumPublicConnections = MaxNumPlayers;
-                        SessionSettings->NumPrivateConnections = 0;
-                        SessionSettings->bAllowInvites = true;
-                        SessionSettings->bAllowJoinInProgress = true;
-                        SessionSettings->bShouldAdvertise = true;
-                        SessionSettings->bAllowJoinViaPresence = true;
-                        SessionSettings->bAllowJoinViaPresenceFriendsOnly = false;
-
-                        SessionSettings->Set(SETTING_MAPNAME, FString("Map_SandBox"), EOnlineDataAdvertisementType::ViaOnlineService);
-
-                        for (auto &setting : SettingsMap) {
-                                SessionSettings->Settings.Add(FName(*setting.Key), setting.Value);
-                        }
-                        OnCreateSessionCompleteDelegateHandle = Sessions->AddOnCreateSessionCompleteDelegate_Handle(OnCreateSessionCompleteDelegate);
-                        return Sessions->CreateSession(*UserId, SessionName, *SessionSettings);
-                }
-        }
-        return false;
+	FNetWorkSessionRequest Request;
+	Request.Stage = Stage;
+	Request.Owner = Owner;
+	Request.SessionName = SessionName;
+	Request.SubsystemName = SubsystemName;
+	pendingSessionRequests.Add(Request);
 }
 
-void UNetWorkGameInstanceSubsystem::OnCreateSessionComplete(FName SessionName, bool bWasSuccessful)
+void UNetWorkGameInstanceSubsystem::RemoveSessionRequest(ESessionStage Stage, FName SessionName, FName SubsystemName)
 {
-	IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get();
-
-	if (OnlineSub) {
-		IOnlineSessionPtr Sessions = OnlineSub->GetSessionInterface();
-
-		if (Sessions.IsValid()) {
-			
-			Sessions->ClearOnCreateSessionCompleteDelegate_Handle(OnCreateSessionCompleteDelegateHandle);
-			
-			if (bWasSuccessful) {
-				OnStartSessionCompleteDelegateHandle = Sessions->AddOnStartSessionCompleteDelegate_Handle(OnStartSessionCompleteDelegate);
+	FNetWorkSessionRequest Request;
+	TakeSessionRequest(Stage, SessionName, SubsystemName, Request);
+}
 
-				Sessions->StartSession(SessionName);
-			}
+void UNetWorkGameInstanceSubsystem::CancelSessionRequests(ESessionStage Stage, ESessionRequestOwner Owner)
+{
+	for (int32 i = pendingSessionRequests.Num() - 1; i >= 0; i--) {
+		if (pendingSessionRequests[i].Stage == Stage && pendingSessionRequests[i].Owner == Owner) {
+			//close the call in the trace, its completion will not be recorded any more
+			sessionTrace.Record(ENetWorkTraceEventType::ESessionAbandoned, (uint8)Stage, 0, (int32)ENetWorkTraceAbandonReason::ECancelled);
+			pendingSessionRequests.RemoveAt(i);
 		}
 	}
 }
 
-void UNetWorkGameInstanceSubsystem::OnStartOnlineGameComplete(FName SessionName, bool bWasSuccessful)
+void UNetWorkGameInstanceSubsystem::CancelSearchRequests(ESessionRequestOwner Owner)
 {
-	IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get();
+	TArray<FName> searchingSubsystems;
+	for (auto &request : pendingSessionRequests) {
+		if (request.Stage == ESessionStage::EFind && request.Owner == Owner) {
+			searchingSubsystems.AddUnique(request.SubsystemName);
+		}
+	}
+	CancelSessionRequests(ESessionStage::EFind, Owner);
 
-	if (OnlineSub) {
-		IOnlineSessionPtr Sessions = OnlineSub->GetSessionInterface();
+	//an instance still running the dropped query would hold back the next search started on it
+	for (FName subsystemName : searchingSubsystems) {
+		IOnlineSessionPtr SourceSessions = GetSessions(subsystemName);
 
-		if (Sessions.IsValid()) {
-			Sessions->ClearOnStartSessionCompleteDelegate_Handle(OnStartSessionCompleteDelegateHandle);
+		if (SourceSessions.IsValid()) {
+			SourceSessions->CancelFindSessions();
 		}
 	}
+}
 
-	if (bWasSuccessful) {
-		UGameplayStatics::OpenLevel(GetWorld(), "Map_SandBox", true, "listen");
+bool UNetWorkGameInstanceSubsystem::TakeSessionRequest(ESessionStage Stage, FName SessionName, FName SubsystemName,
+	FNetWorkSessionRequest& OutRequest)
+{
+	//searches are not tied to a session name, an instance runs one at a time so the oldest is the one answering
+	const int32 Index = pendingSessionRequests.IndexOfByPredicate([Stage, SessionName, SubsystemName](const FNetWorkSessionRequest& Request) {
+		return Request.Stage == Stage && Request.SubsystemName == SubsystemName && (Stage == ESessionStage::EFind || Request.SessionName == SessionName);
+	});
 
-		ChangeState(EGameState::ETravelling);
+	if (Index == INDEX_NONE) {
+		return false;
 	}
+
+	OutRequest = pendingSessionRequests[Index];
+	pendingSessionRequests.RemoveAt(Index);
+	return true;
 }
 
-void UNetWorkGameInstanceSubsystem::FindGames(bool bIsLAN)
+void UNetWorkGameInstanceSubsystem::HandleCreateSessionComplete(FName SessionName, bool bWasSuccessful, FName SubsystemName)
 {
-	IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get();
-	bHasFinishedSearchingForGames = false;
-	bSearchingForGames = false;
-	searchResults.Empty();
+	FNetWorkSessionRequest Request;
 
-	if (OnlineSub) {
-		TSharedPtr<const FUniqueNetId> pid = OnlineSub->GetIdentityInterface()->GetUniquePlayerId(0);
+	if (!TakeSessionRequest(ESessionStage::ECreate, SessionName, SubsystemName, Request)) {
+		return;
+	}
 
-		FindSessions(pid, GameSessionName, bIsLAN);
+	if (Request.Owner == ESessionRequestOwner::EWarmPool) {
+		OnWarmSessionCreated(SessionName, bWasSuccessful);
+	}
+	else {
+		OnCreateSessionComplete(SessionName, bWasSuccessful);
 	}
 }
 
-void UNetWorkGameInstanceSubsystem::FindSessions(TSharedPtr<const FUniqueNetId> UserId, FName SessionName, bool bIsLAN)
+void UNetWorkGameInstanceSubsystem::HandleStartSessionComplete(FName SessionName, bool bWasSuccessful, FName SubsystemName)
 {
-	IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get();
-
-	if (OnlineSub) {
-		IOnlineSessionPtr Sessions = OnlineSub->GetSessionInterface();
-
-		if (Sessions.IsValid() && UserId.IsValid()) {
-			SessionSearch = MakeShareable(new FOnlineSessionSearch());
-			SessionSearch->bIsLanQuery = bIsLAN;
-			SessionSearch->MaxSearchResults = 100000000;
-			SessionSearch->PingBucketSize = 50;
-			SessionSearch->QuerySettings.Set(SEARCH_PRESENCE, true, EOnlineComparisonOp::Equals);
+	FNetWorkSessionRequest Request;
 
-			TSharedRef<FOnlineSessionSearch> SearchSettingsRef = SessionSearch.ToSharedRef();
+	if (TakeSessionRequest(ESessionStage::EStart, SessionName, SubsystemName, Request)) {
+		OnStartOnlineGameComplete(SessionName, bWasSuccessful);
+	}
+}
 
-			OnFindSessionsCompleteDelegateHandle = Sessions->AddOnFindSessionsCompleteDelegate_Handle(OnFindSessionsCompleteDelegate);
+void UNetWorkGameInstanceSubsystem::HandleFindSessionsComplete(bool bWasSuccessful, FName SubsystemName)
+{
+	FNetWorkSessionRequest Request;
 
-			bSearchingForGames = true;
+	if (!TakeSessionRequest(ESessionStage::EFind, NAME_None, SubsystemName, Request)) {
+		return;
+	}
 
-			Sessions->FindSessions(*UserId, SearchSettingsRef);
-		}
+	if (Request.Owner == ESessionRequestOwner::ESearchSource) {
+		OnSearchSourceComplete(bWasSuccessful, SubsystemName);
 	}
 	else {
-		OnFindSessionsComplete(false);
+		OnFindSessionsComplete(bWasSuccessful);
 	}
 }
 
-void UNetWorkGameInstanceSubsystem::OnFindSessionsComplete(bool bWasSuccessful)
+void UNetWorkGameInstanceSubsystem::HandleJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result, FName SubsystemName)
 {
-	IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get();
-
-	if (OnlineSub) {
-		IOnlineSessionPtr Sessions = OnlineSub->GetSessionInterface();
+	FNetWorkSessionRequest Request;
 
-		if (Sessions.IsValid()) {
-			Sessions->ClearOnFindSessionsCompleteDelegate_Handle(OnFindSessionsCompleteDelegateHandle);
-		}
+	if (TakeSessionRequest(ESessionStage::EJoin, SessionName, SubsystemName, Request)) {
+		OnJoinSessionComplete(SessionName, Result);
 	}
+}
 
-	if (bWasSuccessful) {
-		for (auto &result : SessionSearch->SearchResults) {
-			FBlueprintSearchResult newresult = FBlueprintSearchResult(result);
-			searchResults.Add(newresult);
-		}
+void UNetWorkGameInstanceSubsystem::HandleUpdateSessionComplete(FName SessionName, bool bWasSuccessful, FName SubsystemName)
+{
+	FNetWorkSessionRequest Request;
+
+	if (!TakeSessionRequest(ESessionStage::EUpdate, SessionName, SubsystemName, Request)) {
+		return;
 	}
 
-	bHasFinishedSearchingForGames = true;
-	bSearchingForGames = false;
+	if (Request.Owner == ESessionRequestOwner::EWarmPool) {
+		OnWarmSessionUpdated(SessionName, bWasSuccessful);
+	}
+	else if (Request.Owner == ESessionRequestOwner::EAdvertise) {
+		OnAdvertisementUpdated(SessionName, bWasSuccessful);
+	}
+	else {
+		OnUpdateSessionComplete(SessionName, bWasSuccessful);
+	}
 }
 
-void UNetWorkGameInstanceSubsystem::JoinGame(FBlueprintSearchResult result)
+void UNetWorkGameInstanceSubsystem::HandleDestroySessionComplete(FName SessionName, bool bWasSuccessful, FName SubsystemName)
 {
-	IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get();
+	FNetWorkSessionRequest Request;
+
+	//unused warm pool sessions are destroyed without a request, nothing waits for them
+	if (!TakeSessionRequest(ESessionStage::EDestroy, SessionName, SubsystemName, Request)) {
+		return;
+	}
 
-	if (OnlineSub) {
-		TSharedPtr<const FUniqueNetId> pid = OnlineSub->GetIdentityInterface()->GetUniquePlayerId(0);
-		JoinSession(pid, GameSessionName, result.result);
+	if (Request.Owner == ESessionRequestOwner::EFailureCleanUp) {
+		OnFailedSessionDestroyed(SessionName, bWasSuccessful);
+	}
+	else {
+		OnDestroySessionComplete(SessionName, bWasSuccessful);
 	}
 }
 
-bool UNetWorkGameInstanceSubsystem::JoinSession(TSharedPtr<const FUniqueNetId> UserId, FName SessionName,
-	const FOnlineSessionSearchResult& SearchResult)
+void UNetWorkGameInstanceSubsystem::OnFailedSessionDestroyed(FName SessionName, bool bWasSuccessful)
 {
-	bool bSuccessful = false;
-
-	IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get();
+	TraceSessionCallback(ESessionStage::EDestroy, bWasSuccessful);
 
-	if (OnlineSub) {
-		IOnlineSessionPtr Sessions = OnlineSub->GetSessionInterface();
+	//the failed attempt may have used up the warm session, the next HostGame should find one again
+	RefillWarmPool();
+}
 
-		if (Sessions.IsValid() && UserId.IsValid()) {
-			OnJoinSessionCompleteDelegateHandle = Sessions->AddOnJoinSessionCompleteDelegate_Handle(OnJoinSessionCompleteDelegate);
-			bSuccessful = Sessions->JoinSession(*UserId, SessionName, SearchResult);
-		}
-	}
-	return bSuccessful;
+void UNetWorkGameInstanceSubsystem::TraceSessionCall(ESessionStage Stage)
+{
+	//recorded before the call, the NULL subsystem fires the completion inside it
+	sessionTrace.Record(ENetWorkTraceEventType::ESessionCall, (uint8)Stage, 1);
 }
 
-void UNetWorkGameInstanceSubsystem::OnJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result)
+void UNetWorkGameInstanceSubsystem::TraceSessionCallResult(ESessionStage Stage, bool bAccepted, FName SessionName, FName SubsystemName)
 {
-	IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get();
+	if (bAccepted) {
+		return;
+	}
 
-	if (OnlineSub) {
-		IOnlineSessionPtr Sessions = OnlineSub->GetSessionInterface();
+	//a call that fails synchronously may already have fired its completion, which closed the call in the trace
+	//otherwise the request goes with the rejection, so the failure cleanup does not report it as cancelled too
+	FNetWorkSessionRequest Request;
 
-		if (Sessions.IsValid()) {
-			Sessions->ClearOnJoinSessionCompleteDelegate_Handle(OnJoinSessionCompleteDelegateHandle);
+	//a rejected call is written out by FailSessionStage, once for the whole failure
+	if (TakeSessionRequest(Stage, SessionName, SubsystemName, Request)) {
+		sessionTrace.Record(ENetWorkTraceEventType::ESessionAbandoned, (uint8)Stage, 0, (int32)ENetWorkTraceAbandonReason::ERejected);
+	}
+}
 
+void UNetWorkGameInstanceSubsystem::TraceSessionCallback(ESessionStage Stage, bool bWasSuccessful, int32 Detail)
+{
+	sessionTrace.Record(ENetWorkTraceEventType::ESessionCallback, (uint8)Stage, bWasSuccessful ? 1 : 0, Detail);
+}
 
-			APlayerController *const PlayerController = GetWorld()->GetFirstPlayerController();//GetFirstLocalPlayerController();
+FString UNetWorkGameInstanceSubsystem::DumpSessionTrace()
+{
+	return sessionTrace.Dump(TEXT("Requested"));
+}
 
-			FString TravelURL;
+void UNetWorkGameInstanceSubsystem::PublishSessionSnapshot()
+{
+	FNetWorkSessionSnapshot Snapshot;
+	Snapshot.GameState = currentState;
+	Snapshot.bSearchingForGames = bSearchingForGames;
+	Snapshot.NumSearchResults = searchResults.Num();
+
+	IOnlineSessionPtr Sessions = GetSessions(sessionSubsystemName);
+	FNamedOnlineSession *NamedSession = Sessions.IsValid() ? Sessions->GetNamedSession(activeSessionName) : nullptr;
+
+	if (NamedSession) {
+		const FOnlineSessionSettings &Settings = NamedSession->SessionSettings;
+
+		Snapshot.SessionName = activeSessionName;
+		Snapshot.bIsHosting = NamedSession->bHosting;
+		Snapshot.bIsLAN = Settings.bIsLANMatch;
+		Snapshot.bIsInProgress = NamedSession->SessionState == EOnlineSessionState::InProgress;
+		Snapshot.MaxPlayers = Settings.NumPublicConnections + Settings.NumPrivateConnections;
+		Snapshot.NumOpenPublicConnections = NamedSession->NumOpenPublicConnections;
+
+		//the host knows who is logged in, clients only know what the session says
+		Snapshot.NumPlayers = bIsAdvertising ? GetLivePlayerCount() : Settings.NumPublicConnections - NamedSession->NumOpenPublicConnections;
+		if (bIsAdvertising) {
+			Snapshot.bIsInProgress = bAdvertisedInProgress;
+		}
 
-			if (PlayerController && Sessions->GetResolvedConnectString(SessionName, TravelURL)) {
-				PlayerController->ClientTravel(TravelURL, ETravelType::TRAVEL_Absolute);
-				ChangeState(EGameState::ETravelling);
-			}
+		for (auto &setting : Settings.Settings) {
+			Snapshot.Settings.Add(setting.Key, setting.Value.Data.ToString());
 		}
 	}
+
+	sessionSnapshot.Publish(MoveTemp(Snapshot));
 }
 
-FString UNetWorkGameInstanceSubsystem::GetSessionSpecialSettingString(FString key)
+FBlueprintMemoryReport UNetWorkGameInstanceSubsystem::GetMemoryReport()
 {
-	IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get();
+	FBlueprintMemoryReport Report;
+
+	/* SEARCH RESULTS */
+	Report.NumSearchResults = searchResults.Num();
+	Report.SearchResultBytes += searchResults.GetAllocatedSize();
+	for (auto &result : searchResults) {
+		Report.SearchResultBytes += result.ServerName.GetAllocatedSize() + result.MapName.GetAllocatedSize();
+		Report.SearchResultBytes += GetSessionSettingsSize(result.result.Session.SessionSettings) + result.result.Session.OwningUserName.GetAllocatedSize();
+	}
 
-	if (OnlineSub) {
-		IOnlineSessionPtr Sessions = OnlineSub->GetSessionInterface();
+	//SessionSearch is usually also the search of the last multi-source query, count it once
+	TSet<const FOnlineSessionSearch*> countedSearches;
+	if (SessionSearch.IsValid()) {
+		countedSearches.Add(SessionSearch.Get());
+		Report.SearchResultBytes += GetSessionSearchSize(*SessionSearch);
+	}
+	for (auto &state : searchSources) {
+		if (state.Search.IsValid() && !countedSearches.Contains(state.Search.Get())) {
+			countedSearches.Add(state.Search.Get());
+			Report.SearchResultBytes += GetSessionSearchSize(*state.Search);
+		}
+	}
+	Report.SearchResultBytes += searchSources.GetAllocatedSize() + searchSourceReports.GetAllocatedSize() + searchResultIndexById.GetAllocatedSize();
+	for (auto &entry : searchResultIndexById) {
+		Report.SearchResultBytes += entry.Key.GetAllocatedSize();
+	}
 
-		if (Sessions.IsValid()) {
-			FOnlineSessionSettings *settings = Sessions->GetSessionSettings(GameSessionName);
+	/* SESSION SETTINGS */
+	if (SessionSettings.IsValid()) {
+		Report.SessionSettingsBytes += sizeof(FOnlineSessionSettings) + GetSessionSettingsSize(*SessionSettings);
+	}
+	if (pendingFastJoin.IsSet()) {
+		Report.SessionSettingsBytes += GetSessionSettingsSize(pendingFastJoin.GetValue().Session.SessionSettings);
+	}
 
-			if (settings) {
-				if (settings->Settings.Contains(FName(*key))) {
-					FString value;
-					settings->Settings[FName(*key)].Data.GetValue(value);
+	//the interface owns the copies of our own sessions but they only exist because of us
+	IOnlineSessionPtr Sessions = GetSessions(sessionSubsystemName);
+	if (Sessions.IsValid()) {
+		if (FNamedOnlineSession *NamedSession = Sessions->GetNamedSession(activeSessionName)) {
+			Report.SessionSettingsBytes += sizeof(FNamedOnlineSession) + GetSessionSettingsSize(NamedSession->SessionSettings);
+		}
+	}
 
-					return value;
-				}
-				else {
-					return FString("INVALID KEY");
-				}
-			}
+	IOnlineSessionPtr DefaultSessions = GetSessions();
+	Report.SessionSettingsBytes += warmSessions.GetAllocatedSize();
+	for (auto &warmSession : warmSessions) {
+		FNamedOnlineSession *NamedSession = DefaultSessions.IsValid() ? DefaultSessions->GetNamedSession(warmSession.SessionName) : nullptr;
+		if (NamedSession) {
+			Report.SessionSettingsBytes += sizeof(FNamedOnlineSession) + GetSessionSettingsSize(NamedSession->SessionSettings);
 		}
-		else {
-			return FString("NO SESSION!");
+	}
+
+	/* WIDGETS */
+	//serializing a widget tree is far too slow for every state change, sizes are cached per class until the tree grows or shrinks
+	Report.WidgetBytes += GetCachedWidgetSize(currentWidget);
+	for (UUserWidget *widget : preloadedWidgets) {
+		Report.WidgetBytes += GetCachedWidgetSize(widget);
+	}
+	for (UClass *widgetClass : { cMainMenu.Get(), cMPHome.Get(), cMPJoin.Get(), cMPHost.Get(), cLoadingScreen.Get() }) {
+		Report.WidgetBytes += GetCachedWidgetClassSize(widgetClass);
+	}
+	Report.WidgetBytes += widgetSizeByClass.GetAllocatedSize() + widgetClassSizes.GetAllocatedSize();
+
+	/* PENDING DELEGATES */
+	//a registered delegate is copied into the multicast list of the interface or the game mode
+	auto countDelegate = [&Report](const FDelegateHandle& Handle, SIZE_T Size) {
+		if (Handle.IsValid()) {
+			Report.NumPendingDelegates++;
+			Report.PendingDelegateBytes += Size;
 		}
+	};
+	for (auto &bound : boundSessionInterfaces) {
+		countDelegate(bound.Value.CreateHandle, sizeof(FOnCreateSessionCompleteDelegate));
+		countDelegate(bound.Value.StartHandle, sizeof(FOnStartSessionCompleteDelegate));
+		countDelegate(bound.Value.FindHandle, sizeof(FOnFindSessionsCompleteDelegate));
+		countDelegate(bound.Value.JoinHandle, sizeof(FOnJoinSessionCompleteDelegate));
+		countDelegate(bound.Value.UpdateHandle, sizeof(FOnUpdateSessionCompleteDelegate));
+		countDelegate(bound.Value.DestroyHandle, sizeof(FOnDestroySessionCompleteDelegate));
 	}
-	return FString("NO ONLINE SUBSYSTEM");
-}
+	countDelegate(OnSessionUserInviteAcceptedDelegateHandle, sizeof(FOnSessionUserInviteAcceptedDelegate));
+	countDelegate(OnFindFriendSessionCompleteDelegateHandle, sizeof(FOnFindFriendSessionCompleteDelegate));
+	countDelegate(advertiseLoginHandle, sizeof(FDelegateBase));
+	countDelegate(advertiseLogoutHandle, sizeof(FDelegateBase));
+	countDelegate(advertiseMatchStateHandle, sizeof(FDelegateBase));
+	Report.PendingDelegateBytes += boundSessionInterfaces.GetAllocatedSize() + pendingSessionRequests.GetAllocatedSize();
 
-void UNetWorkGameInstanceSubsystem::SetOrUpdateSessionSpecialSettingString(FBlueprintSessionSetting newSetting)
-{
-	IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get();
+	/* TRACE */
+	Report.TraceBytes = sessionTrace.GetAllocatedSize();
 
-	if (OnlineSub) {
-		IOnlineSessionPtr Sessions = OnlineSub->GetSessionInterface();
+	Report.TotalBytes = Report.SearchResultBytes + Report.SessionSettingsBytes + Report.WidgetBytes + Report.PendingDelegateBytes + Report.TraceBytes;
 
-		if (Sessions.IsValid()) {
-			FOnlineSessionSettings *settings = Sessions->GetSessionSettings(GameSessionName);
+	memoryHighWaterBytes = FMath::Max(memoryHighWaterBytes, Report.TotalBytes);
+	Report.HighWaterBytes = memoryHighWaterBytes;
 
-			if (settings) {
-				if (settings->Settings.Contains(FName(*newSetting.key))) {
-					
-					settings->Settings[FName(*newSetting.key)].Data = newSetting.value;
-				}
-				else { 
-					FOnlineSessionSetting setting;
+	return Report;
+}
 
-					setting.Data = newSetting.value;
-					setting.AdvertisementType = EOnlineDataAdvertisementType::ViaOnlineService;
-					
-					settings->Settings.Add(FName(*newSetting.key), setting);
-				}
+int64 UNetWorkGameInstanceSubsystem::GetCachedWidgetSize(UUserWidget* Widget)
+{
+	if (!Widget) {
+		return 0;
+	}
 
-				OnUpdateSessionCompleteDelegateHandle = Sessions->AddOnUpdateSessionCompleteDelegate_Handle(OnUpdateSessionCompleteDelegate);
+	//counting is cheap next to serializing, a server list that gained rows owns more objects
+	int32 NumObjects = 0;
+	ForEachObjectWithOuter(Widget, [&NumObjects](UObject*) { NumObjects++; }, true);
 
-				Sessions->UpdateSession(GameSessionName, *settings, true);
-			}
-		}
+	//widgets of one class build the same tree, the last one measured stands in for the rest
+	const TObjectKey<UClass> WidgetClass(Widget->GetClass());
+	const FNetWorkWidgetSize *Cached = widgetSizeByClass.Find(WidgetClass);
+	if (Cached && Cached->NumObjects == NumObjects) {
+		return Cached->Bytes;
 	}
+
+	FNetWorkWidgetSize &Size = widgetSizeByClass.Add(WidgetClass);
+	Size.Bytes = GetObjectSize(Widget);
+	Size.NumObjects = NumObjects;
+	return Size.Bytes;
 }
 
-void UNetWorkGameInstanceSubsystem::OnUpdateSessionComplete(FName SessionName, bool bWasSuccessful)
+int64 UNetWorkGameInstanceSubsystem::GetCachedWidgetClassSize(UClass* WidgetClass)
 {
-	IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get();
+	if (!WidgetClass) {
+		return 0;
+	}
+
+	const TObjectKey<UClass> Key(WidgetClass);
+	if (const int64 *Bytes = widgetClassSizes.Find(Key)) {
+		return *Bytes;
+	}
+	return widgetClassSizes.Add(Key, GetObjectSize(WidgetClass));
+}
 
-	if (OnlineSub) {
-		IOnlineSessionPtr Sessions = OnlineSub->GetSessionInterface();
+void UNetWorkGameInstanceSubsystem::LogMemoryReport()
+{
+	const FBlueprintMemoryReport Report = GetMemoryReport();
+
+	UE_LOG(LogNetWorkSubsystem, Log, TEXT("NetWorkSubsystem memory: %.1f KB (high-water %.1f KB)"), Report.TotalBytes / 1024.0, Report.HighWaterBytes / 1024.0);
+	UE_LOG(LogNetWorkSubsystem, Log, TEXT("  Search results:   %8.1f KB (%d results)"), Report.SearchResultBytes / 1024.0, Report.NumSearchResults);
+	UE_LOG(LogNetWorkSubsystem, Log, TEXT("  Session settings: %8.1f KB"), Report.SessionSettingsBytes / 1024.0);
+	UE_LOG(LogNetWorkSubsystem, Log, TEXT("  Widgets:          %8.1f KB"), Report.WidgetBytes / 1024.0);
+	UE_LOG(LogNetWorkSubsystem, Log, TEXT("  Delegates:        %8.1f KB (%d pending)"), Report.PendingDelegateBytes / 1024.0, Report.NumPendingDelegates);
+	UE_LOG(LogNetWorkSubsystem, Log, TEXT("  Trace:            %8.1f KB"), Report.TraceBytes / 1024.0);
+}
 
-		if (Sessions.IsValid()) {
-			Sessions->ClearOnUpdateSessionCompleteDelegate_Handle(OnUpdateSessionCompleteDelegateHandle);
-		}
-	}   
+void UNetWorkGameInstanceSubsystem::ResetMemoryHighWater()
+{
+	memoryHighWaterBytes = 0;
+	GetMemoryReport();
 }
 
-void UNetWorkGameInstanceSubsystem::LeaveGame()
+void UNetWorkGameInstanceSubsystem::UpdateMemoryHighWater()
 {
-	IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get();
+	const int64 PreviousHighWater = memoryHighWaterBytes;
+	const int64 BudgetBytes = (int64)CVarSessionMemoryBudgetKB.GetValueOnGameThread() * 1024;
 
-	if (OnlineSub) {
-		IOnlineSessionPtr Sessions = OnlineSub->GetSessionInterface();
+	GetMemoryReport();
 
-		if (Sessions.IsValid()) {
-			OnDestroySessionCompleteDelegateHandle = Sessions->AddOnDestroySessionCompleteDelegate_Handle(OnDestroySessionCompleteDelegate);
-			Sessions->DestroySession(GameSessionName);
-		}
+	if (BudgetBytes > 0 && memoryHighWaterBytes > BudgetBytes && memoryHighWaterBytes > PreviousHighWater) {
+		UE_LOG(LogNetWorkSubsystem, Warning, TEXT("NetWorkSubsystem memory high-water %.1f KB is over the %d KB budget"), memoryHighWaterBytes / 1024.0, CVarSessionMemoryBudgetKB.GetValueOnGameThread());
 	}
 }
 
-void UNetWorkGameInstanceSubsystem::OnDestroySessionComplete(FName SessionName, bool bWasSuccessful)
+FString UNetWorkGameInstanceSubsystem::RunLifecycleBenchmark(int32 Iterations)
 {
+	Iterations = FMath::Max(Iterations, 1);
+
 	IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get();
+	if (!OnlineSub || !OnlineSub->GetSessionInterface().IsValid() || !OnlineSub->GetIdentityInterface().IsValid()) {
+		return FString("NO ONLINE SUBSYSTEM");
+	}
 
-	if (OnlineSub) {
-		IOnlineSessionPtr Sessions = OnlineSub->GetSessionInterface();
+	const FName BenchSessionName = FName("LifecycleBenchmark");
+	const FOnCreateSessionCompleteDelegate BenchDelegate = FOnCreateSessionCompleteDelegate::CreateWeakLambda(this, [](FName, bool) {});
+	int32 NumValidIds = 0;
 
-		if (Sessions.IsValid()) {
-			Sessions->ClearOnDestroySessionCompleteDelegate_Handle(OnDestroySessionCompleteDelegateHandle);
+	//before: every call looked the subsystem and both interfaces up and bound its delegate, every callback looked them up again to unbind it
+	const double BeforeStart = FPlatformTime::Seconds();
+	for (int32 i = 0; i < Iterations; i++) {
+		IOnlineSubsystem *CallSub = IOnlineSubsystem::Get();
+		TSharedPtr<const FUniqueNetId> pid = CallSub->GetIdentityInterface()->GetUniquePlayerId(0);
+		NumValidIds += pid.IsValid() ? 1 : 0;
+		FDelegateHandle Handle = CallSub->GetSessionInterface()->AddOnCreateSessionCompleteDelegate_Handle(BenchDelegate);
 
-		}
+		IOnlineSubsystem *CallbackSub = IOnlineSubsystem::Get();
+		CallbackSub->GetSessionInterface()->ClearOnCreateSessionCompleteDelegate_Handle(Handle);
 	}
-	if (bWasSuccessful) {
-		UGameplayStatics::OpenLevel(GetWorld(), "Map_MainMenu", true);
-		ChangeState(EGameState::ETravelling);
+	const double BeforeSeconds = FPlatformTime::Seconds() - BeforeStart;
+
+	//after: cached interfaces, the delegates stay bound and only a request goes in and out
+	const double AfterStart = FPlatformTime::Seconds();
+	for (int32 i = 0; i < Iterations; i++) {
+		TSharedPtr<const FUniqueNetId> pid = GetLocalPlayerId();
+		NumValidIds += pid.IsValid() ? 1 : 0;
+		GetSessions();
+		AddSessionRequest(ESessionStage::ECreate, ESessionRequestOwner::EHostGame, BenchSessionName, NAME_None);
+
+		FNetWorkSessionRequest Request;
+		TakeSessionRequest(ESessionStage::ECreate, BenchSessionName, NAME_None, Request);
 	}
-}
+	const double AfterSeconds = FPlatformTime::Seconds() - AfterStart;
 
-void UNetWorkGameInstanceSubsystem::HandleNetworkError(UWorld* World, UNetDriver* NetDriver,
-	ENetworkFailure::Type FailureType, const FString& ErrorString)
-{
-	LeaveGame();
+	const double BeforeNs = BeforeSeconds * 1e9 / Iterations;
+	const double AfterNs = AfterSeconds * 1e9 / Iterations;
+
+	const FString Summary = FString::Printf(TEXT("Session lifecycle overhead over %d calls on %s: before %.1f ns/call, after %.1f ns/call (%.1fx), %d player ids resolved"),
+		Iterations, *OnlineSub->GetSubsystemName().ToString(), BeforeNs, AfterNs, AfterNs > 0.0 ? BeforeNs / AfterNs : 0.0, NumValidIds);
+	UE_LOG(LogNetWorkSubsystem, Log, TEXT("%s"), *Summary);
+
+	return Summary;
 }
 
 void UNetWorkGameInstanceSubsystem::EnterState(EGameState newState)
 {
+	LLM_SCOPE_BYTAG(NetWorkSubsystem_Widgets);
+
 	 //set the current state to newState
     currentState = newState;
+	sessionTrace.Record(ENetWorkTraceEventType::EStateEnter, (uint8)newState);
+
+	//a dedicated server only tracks the state, it has no viewport to show widgets in and no player to give input to
+	if (IsRunningDedicatedServer()) {
+		return;
+	}
 
     switch (currentState)
 	{
 	    case EGameState::ELoadingScreen:
 	    	{
 	            //create the widget
-	            currentWidget = CreateWidget<UUserWidget>(GetWorld()->GetFirstPlayerController(), cLoadingScreen);
+	            currentWidget = AcquireStateWidget(cLoadingScreen);
 	            //add the widget to the viewport
 	          
 	            if (currentWidget)
@@ -454,7 +2160,7 @@ void UNetWorkGameInstanceSubsystem::EnterState(EGameState newState)
 	    case EGameState::EMainMenu:
 	    	{
 	            //create the widget
-	            currentWidget = CreateWidget<UUserWidget>(GetWorld()->GetFirstPlayerController(), cMainMenu);
+	            currentWidget = AcquireStateWidget(cMainMenu);
 	            if (currentWidget)
 	            {
 	            //add the widget to the viewport
@@ -469,7 +2175,7 @@ void UNetWorkGameInstanceSubsystem::EnterState(EGameState newState)
 	    case EGameState::EMultiplayerHome:
 	    	{
 	            //create the widget
-	            currentWidget = CreateWidget<UUserWidget>(GetWorld()->GetFirstPlayerController(), cMPHome);
+	            currentWidget = AcquireStateWidget(cMPHome);
 	            if (currentWidget)
 	            {
 	                    //add the widget to the viewport
@@ -485,7 +2191,7 @@ void UNetWorkGameInstanceSubsystem::EnterState(EGameState newState)
 	    case EGameState::EMultiplayerJoin:
 	    	{
 	            //create the widget
-	            currentWidget = CreateWidget<UUserWidget>(GetWorld()->GetFirstPlayerController(), cMPJoin);
+	            currentWidget = AcquireStateWidget(cMPJoin);
 	            //add the widget to the viewport
 	            if (true)
 	            {
@@ -500,7 +2206,7 @@ void UNetWorkGameInstanceSubsystem::EnterState(EGameState newState)
 	    case EGameState::EMultiplayerHost:
 	    	{
 	            //create the widget
-	            currentWidget = CreateWidget<UUserWidget>(GetWorld()->GetFirstPlayerController(), cMPHost);
+	            currentWidget = AcquireStateWidget(cMPHost);
 	            if (true)
 	            {
 	                    //add the widget to the viewport
@@ -521,6 +2227,17 @@ void UNetWorkGameInstanceSubsystem::EnterState(EGameState newState)
 	            SetInputMode(EInputMode::EUIOnly, false);
 	            break;
 			}
+	    case EGameState::ENetworkError:
+	    	{
+	            //back to the main menu so the player can try again, LastSessionError says what went wrong
+	            currentWidget = AcquireStateWidget(cMainMenu);
+	            if (currentWidget)
+	            {
+	                    currentWidget->AddToViewport();
+	                    SetInputMode(EInputMode::EUIOnly, true);
+	            }
+	            break;
+			}
 	    case EGameState::ENone:
 	    	{
 	            break;
@@ -530,10 +2247,15 @@ void UNetWorkGameInstanceSubsystem::EnterState(EGameState newState)
 	            break;
 			}
     }
+
+	//start building what the player is likely to open next
+	UpdateWidgetPreloadQueue();
 }
 
 void UNetWorkGameInstanceSubsystem::LeaveState()
 {
+	sessionTrace.Record(ENetWorkTraceEventType::EStateLeave, (uint8)currentState);
+
 	switch (currentState) {
 	case EGameState::ELoadingScreen: {
 		
@@ -548,6 +2270,9 @@ void UNetWorkGameInstanceSubsystem::LeaveState()
 		
 	}
 	case EGameState::EMultiplayerHost: {
+		
+	}
+	case EGameState::ENetworkError: {
 			if (currentWidget) {
 				currentWidget->RemoveFromViewport();
 				currentWidget = nullptr;
@@ -570,6 +2295,103 @@ void UNetWorkGameInstanceSubsystem::LeaveState()
 	EnterState(EGameState::ENone);
 }
 
+TSubclassOf<UUserWidget> UNetWorkGameInstanceSubsystem::GetStateWidgetClass(EGameState State)
+{
+	switch (State) {
+	case EGameState::ELoadingScreen:		return cLoadingScreen;
+	case EGameState::EMainMenu:				return cMainMenu;
+	case EGameState::EMultiplayerHome:		return cMPHome;
+	case EGameState::EMultiplayerJoin:		return cMPJoin;
+	case EGameState::EMultiplayerHost:		return cMPHost;
+	case EGameState::ENetworkError:			return cMainMenu;
+	default:								return nullptr;
+	}
+}
+
+UUserWidget* UNetWorkGameInstanceSubsystem::AcquireStateWidget(TSubclassOf<UUserWidget> WidgetClass)
+{
+	APlayerController *PlayerController = GetWorld()->GetFirstPlayerController();
+
+	for (int32 i = 0; i < preloadedWidgets.Num(); i++) {
+		UUserWidget *widget = preloadedWidgets[i];
+
+		//a widget built for a player controller of the previous level cannot be shown
+		if (widget && widget->GetClass() == WidgetClass && widget->GetOwningPlayer() == PlayerController) {
+			preloadedWidgets.RemoveAt(i);
+			WidgetPreloadHits++;
+			return widget;
+		}
+	}
+
+	if (WidgetClass) {
+		WidgetPreloadMisses++;
+	}
+	return CreateWidget<UUserWidget>(PlayerController, WidgetClass);
+}
+
+void UNetWorkGameInstanceSubsystem::UpdateWidgetPreloadQueue()
+{
+	//LeaveState passes through None on the way to the next state, keep everything until that one is known
+	if (currentState == EGameState::ENone) {
+		return;
+	}
+
+	stateEnteredFrame = GFrameCounter;
+	preloadQueue.Reset();
+
+	if (bPreloadNextStateWidgets) {
+		if (const FBlueprintStateTransitions *transitions = StateTransitions.Find(currentState)) {
+			for (EGameState nextState : transitions->LikelyNextStates) {
+				TSubclassOf<UUserWidget> widgetClass = GetStateWidgetClass(nextState);
+
+				if (widgetClass && !preloadQueue.Contains(widgetClass) && preloadQueue.Num() < MaxPreloadedWidgets) {
+					preloadQueue.Add(widgetClass);
+				}
+			}
+		}
+	}
+
+	//only the widgets of the likely next states stay in memory
+	for (int32 i = preloadedWidgets.Num() - 1; i >= 0; i--) {
+		if (!preloadedWidgets[i] || !preloadQueue.Contains(preloadedWidgets[i]->GetClass())) {
+			preloadedWidgets.RemoveAt(i);
+		}
+	}
+}
+
+bool UNetWorkGameInstanceSubsystem::TickWidgetPreload(float DeltaTime)
+{
+	LLM_SCOPE_BYTAG(NetWorkSubsystem_Widgets);
+
+	//keep out of the frame that built the current screen and of frames that are already slow
+	if (preloadQueue.Num() == 0 || GFrameCounter == stateEnteredFrame || DeltaTime * 1000.0f > WidgetPreloadMaxFrameMs) {
+		return true;
+	}
+
+	UWorld *World = GetWorld();
+	APlayerController *PlayerController = World ? World->GetFirstPlayerController() : nullptr;
+	if (!PlayerController || preloadedWidgets.Num() >= MaxPreloadedWidgets) {
+		return true;
+	}
+
+	//build the most likely missing widget, one per frame
+	for (auto &widgetClass : preloadQueue) {
+		const bool bAlreadyBuilt = preloadedWidgets.ContainsByPredicate([&widgetClass](UUserWidget* widget) { return widget && widget->GetClass() == widgetClass; });
+
+		//the screen on display would otherwise be built a second time
+		if (bAlreadyBuilt || (currentWidget && currentWidget->GetClass() == widgetClass)) {
+			continue;
+		}
+
+		//only the widget tree is built here, Construct runs when the state adds it to the viewport
+		if (UUserWidget *widget = CreateWidget<UUserWidget>(PlayerController, widgetClass)) {
+			preloadedWidgets.Add(widget);
+		}
+		break;
+	}
+	return true;
+}
+
 FString UNetWorkGameInstanceSubsystem::ReturnPath()
 {
 	
@@ -0,0 +1,380 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NetWorkLoadGenerator.h"
+#include "NetWorkSubsystem.h"
+#include "NetWorkSessionEmulator.h"
+#include "OnlineSubsystem.h"
+#include "OnlineSubsystemModule.h"
+#include "Modules/ModuleManager.h"
+#include "OnlineSessionSettings.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Parse.h"
+
+//the generator driven by the console commands
+static TUniquePtr<FNetWorkLoadGenerator> GLoadGenerator;
+
+static FAutoConsoleCommand CmdLoadGenStart(
+	TEXT("net.LoadGen.Start"),
+	TEXT("Start simulated clients finding, joining and leaving a local host. Clients=N Rate=CyclesPerSecond Duration=Seconds Timeout=Seconds LAN=0|1 Host=0|1 Subsystem=Name"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args) {
+		FNetWorkLoadSettings Settings;
+		const FString Line = FString::Join(Args, TEXT(" "));
+		FString Subsystem;
+
+		FParse::Value(*Line, TEXT("Clients="), Settings.NumClients);
+		FParse::Value(*Line, TEXT("Rate="), Settings.CyclesPerSecond);
+		FParse::Value(*Line, TEXT("Duration="), Settings.Duration);
+		FParse::Value(*Line, TEXT("Timeout="), Settings.OperationTimeout);
+		FParse::Bool(*Line, TEXT("LAN="), Settings.bIsLAN);
+		FParse::Bool(*Line, TEXT("Host="), Settings.bHostSession);
+		if (FParse::Value(*Line, TEXT("Subsystem="), Subsystem)) {
+			Settings.SubsystemName = FName(*Subsystem);
+		}
+
+		if (GLoadGenerator.IsValid() && GLoadGenerator->IsRunning()) {
+			GLoadGenerator->Stop();
+		}
+		GLoadGenerator = MakeUnique<FNetWorkLoadGenerator>();
+		GLoadGenerator->Start(Settings);
+	}));
+
+static FAutoConsoleCommand CmdLoadGenStop(
+	TEXT("net.LoadGen.Stop"),
+	TEXT("Stop the simulated clients and log the report."),
+	FConsoleCommandDelegate::CreateLambda([]() {
+		if (GLoadGenerator.IsValid()) {
+			GLoadGenerator->Stop();
+		}
+	}));
+
+static FAutoConsoleCommand CmdLoadGenReport(
+	TEXT("net.LoadGen.Report"),
+	TEXT("Log throughput, error rate and latency percentiles of the current or last load run."),
+	FConsoleCommandDelegate::CreateLambda([]() {
+		if (GLoadGenerator.IsValid()) {
+			GLoadGenerator->LogReport();
+		}
+	}));
+
+void FNetWorkLoadGenerator::ShutdownConsoleGenerator()
+{
+	//a run with Duration=0 would otherwise be stopped by the static destructor, after the online modules are gone
+	if (GLoadGenerator.IsValid() && GLoadGenerator->IsRunning()) {
+		GLoadGenerator->Stop();
+	}
+	GLoadGenerator.Reset();
+}
+
+FNetWorkLoadGenerator::FNetWorkLoadGenerator()
+{
+	bRunning = false;
+	StartTime = 0.0;
+	StopTime = 0.0;
+	CycleBudget = 0.0;
+	NextClient = 0;
+}
+
+FNetWorkLoadGenerator::~FNetWorkLoadGenerator()
+{
+	if (bRunning) {
+		Stop();
+	}
+}
+
+bool FNetWorkLoadGenerator::Start(const FNetWorkLoadSettings& InSettings)
+{
+	Settings = InSettings;
+	Settings.NumClients = FMath::Max(Settings.NumClients, 1);
+
+	if (Settings.bHostSession && !CreateHost()) {
+		UE_LOG(LogNetWorkSubsystem, Warning, TEXT("LoadGen: could not create the host session on %s"), *Settings.SubsystemName.ToString());
+		return false;
+	}
+
+	for (int32 i = 0; i < Settings.NumClients; i++) {
+		FClient Client;
+		Client.InstanceName = FName(*FString::Printf(TEXT("%s:LoadGenClient%d"), *Settings.SubsystemName.ToString(), i));
+
+		IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get(Client.InstanceName);
+		Client.Sessions = OnlineSub ? OnlineSub->GetSessionInterface() : IOnlineSessionPtr();
+
+		if (!Client.Sessions.IsValid()) {
+			UE_LOG(LogNetWorkSubsystem, Warning, TEXT("LoadGen: could not create session interface %s"), *Client.InstanceName.ToString());
+			continue;
+		}
+
+		//bound once, every instance only ever sees its own client's operations
+		Client.FindHandle = Client.Sessions->AddOnFindSessionsCompleteDelegate_Handle(FOnFindSessionsCompleteDelegate::CreateRaw(this, &FNetWorkLoadGenerator::OnFindComplete, Clients.Num()));
+		Client.JoinHandle = Client.Sessions->AddOnJoinSessionCompleteDelegate_Handle(FOnJoinSessionCompleteDelegate::CreateRaw(this, &FNetWorkLoadGenerator::OnJoinComplete, Clients.Num()));
+		Client.DestroyHandle = Client.Sessions->AddOnDestroySessionCompleteDelegate_Handle(FOnDestroySessionCompleteDelegate::CreateRaw(this, &FNetWorkLoadGenerator::OnDestroyComplete, Clients.Num()));
+
+		Clients.Add(Client);
+	}
+
+	if (Clients.Num() == 0) {
+		DestroyHost();
+		return false;
+	}
+
+	bRunning = true;
+	StartTime = FPlatformTime::Seconds();
+	StopTime = 0.0;
+	CycleBudget = 0.0;
+	NextClient = 0;
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FNetWorkLoadGenerator::Tick), 0.0f);
+
+	UE_LOG(LogNetWorkSubsystem, Display, TEXT("LoadGen: started %d clients at %.2f cycles/s for %.1f s"), Clients.Num(), Settings.CyclesPerSecond, Settings.Duration);
+	return true;
+}
+
+void FNetWorkLoadGenerator::Stop()
+{
+	if (!bRunning) {
+		return;
+	}
+
+	bRunning = false;
+	StopTime = FPlatformTime::Seconds();
+	FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+
+	LogReport();
+
+	for (auto &Client : Clients) {
+		Client.Sessions->ClearOnFindSessionsCompleteDelegate_Handle(Client.FindHandle);
+		Client.Sessions->ClearOnJoinSessionCompleteDelegate_Handle(Client.JoinHandle);
+		Client.Sessions->ClearOnDestroySessionCompleteDelegate_Handle(Client.DestroyHandle);
+
+		if (Client.Sessions->GetNamedSession(NAME_GameSession)) {
+			Client.Sessions->DestroySession(NAME_GameSession);
+		}
+		Client.Sessions.Reset();
+
+		if (FOnlineSubsystemModule *OnlineModule = FModuleManager::GetModulePtr<FOnlineSubsystemModule>("OnlineSubsystem")) {
+			OnlineModule->DestroyOnlineSubsystem(Client.InstanceName);
+		}
+	}
+	Clients.Empty();
+
+	DestroyHost();
+}
+
+bool FNetWorkLoadGenerator::Tick(float DeltaTime)
+{
+	const double Now = FPlatformTime::Seconds();
+
+	if (Settings.Duration > 0.0f && Now - StartTime >= Settings.Duration) {
+		Stop();
+		return false;
+	}
+
+	//operations that never answered count as errors and free the client
+	for (int32 i = 0; i < Clients.Num(); i++) {
+		FClient &Client = Clients[i];
+
+		if (Client.Step == EClientStep::EIdle || Now - Client.StepStartTime < Settings.OperationTimeout) {
+			continue;
+		}
+
+		switch (Client.Step) {
+		case EClientStep::EFinding: {
+			//a search left running would still fill the results of the next cycle
+			Client.Sessions->CancelFindSessions();
+			FailCycle(i, FindStats);
+			break;
+		}
+		case EClientStep::EJoining: FailCycle(i, JoinStats); break;
+		case EClientStep::ELeaving: FailCycle(i, LeaveStats); break;
+		default: break;
+		}
+	}
+
+	//hand the cycles owed since the last tick to idle clients, round robin
+	CycleBudget = FMath::Min(CycleBudget + DeltaTime * Settings.CyclesPerSecond, (double)Clients.Num());
+
+	for (int32 Checked = 0; Checked < Clients.Num() && CycleBudget >= 1.0; Checked++) {
+		const int32 ClientIndex = NextClient;
+		NextClient = (NextClient + 1) % Clients.Num();
+
+		if (Clients[ClientIndex].Step == EClientStep::EIdle) {
+			CycleBudget -= 1.0;
+			StartCycle(ClientIndex);
+		}
+	}
+
+	return true;
+}
+
+void FNetWorkLoadGenerator::StartCycle(int32 ClientIndex)
+{
+	FClient &Client = Clients[ClientIndex];
+
+	Client.Search = MakeShareable(new FOnlineSessionSearch());
+	Client.Search->bIsLanQuery = Settings.bIsLAN;
+	Client.Search->MaxSearchResults = 100;
+	Client.Search->QuerySettings.Set(SEARCH_PRESENCE, true, EOnlineComparisonOp::Equals);
+
+	Client.Step = EClientStep::EFinding;
+	Client.StepStartTime = FPlatformTime::Seconds();
+	Client.CycleStartTime = Client.StepStartTime;
+	Client.bCycleFailed = false;
+
+	if (!FNetWorkSessionEmulator(Client.Sessions).FindSessions(0, Client.Search.ToSharedRef())) {
+		FailCycle(ClientIndex, FindStats);
+	}
+}
+
+void FNetWorkLoadGenerator::OnFindComplete(bool bWasSuccessful, int32 ClientIndex)
+{
+	if (!bRunning || Clients[ClientIndex].Step != EClientStep::EFinding) {
+		return;
+	}
+	FClient &Client = Clients[ClientIndex];
+
+	if (!bWasSuccessful || Client.Search->SearchResults.Num() == 0) {
+		FailCycle(ClientIndex, FindStats);
+		return;
+	}
+	FinishStep(ClientIndex, FindStats, true);
+
+	Client.Step = EClientStep::EJoining;
+	if (!FNetWorkSessionEmulator(Client.Sessions).JoinSession(0, NAME_GameSession, Client.Search->SearchResults[0])) {
+		FailCycle(ClientIndex, JoinStats);
+	}
+}
+
+void FNetWorkLoadGenerator::OnJoinComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result, int32 ClientIndex)
+{
+	if (!bRunning || Clients[ClientIndex].Step != EClientStep::EJoining) {
+		return;
+	}
+	FClient &Client = Clients[ClientIndex];
+
+	const bool bJoined = Result == EOnJoinSessionCompleteResult::Success;
+	FinishStep(ClientIndex, JoinStats, bJoined);
+	Client.bCycleFailed |= !bJoined;
+
+	//leave even after a failed join, it may have left a half created session behind
+	Client.Step = EClientStep::ELeaving;
+	if (!FNetWorkSessionEmulator(Client.Sessions).DestroySession(NAME_GameSession)) {
+		FailCycle(ClientIndex, LeaveStats);
+	}
+}
+
+void FNetWorkLoadGenerator::OnDestroyComplete(FName SessionName, bool bWasSuccessful, int32 ClientIndex)
+{
+	if (!bRunning || Clients[ClientIndex].Step != EClientStep::ELeaving) {
+		return;
+	}
+	FClient &Client = Clients[ClientIndex];
+
+	FinishStep(ClientIndex, LeaveStats, bWasSuccessful);
+
+	//a cycle only completes when every step of it succeeded
+	if (bWasSuccessful && !Client.bCycleFailed) {
+		CycleStats.LatenciesMs.Add((float)((FPlatformTime::Seconds() - Client.CycleStartTime) * 1000.0));
+	}
+	else {
+		CycleStats.Errors++;
+	}
+	Client.Step = EClientStep::EIdle;
+}
+
+void FNetWorkLoadGenerator::FinishStep(int32 ClientIndex, FOperationStats& Stats, bool bWasSuccessful)
+{
+	FClient &Client = Clients[ClientIndex];
+	const double Now = FPlatformTime::Seconds();
+
+	if (bWasSuccessful) {
+		Stats.LatenciesMs.Add((float)((Now - Client.StepStartTime) * 1000.0));
+	}
+	else {
+		Stats.Errors++;
+	}
+	Client.StepStartTime = Now;
+}
+
+void FNetWorkLoadGenerator::FailCycle(int32 ClientIndex, FOperationStats& Stats)
+{
+	FClient &Client = Clients[ClientIndex];
+
+	Stats.Errors++;
+	CycleStats.Errors++;
+
+	//make sure the next cycle starts without a session
+	if (Client.Sessions->GetNamedSession(NAME_GameSession)) {
+		Client.Sessions->DestroySession(NAME_GameSession);
+	}
+	Client.Step = EClientStep::EIdle;
+}
+
+bool FNetWorkLoadGenerator::CreateHost()
+{
+	HostInstanceName = FName(*FString::Printf(TEXT("%s:LoadGenHost"), *Settings.SubsystemName.ToString()));
+
+	IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get(HostInstanceName);
+	HostSessions = OnlineSub ? OnlineSub->GetSessionInterface() : IOnlineSessionPtr();
+
+	if (!HostSessions.IsValid()) {
+		return false;
+	}
+
+	FOnlineSessionSettings HostSettings;
+	HostSettings.bIsLANMatch = Settings.bIsLAN;
+	HostSettings.bUsesPresence = true;
+	HostSettings.NumPublicConnections = Settings.NumClients + 1;
+	HostSettings.bAllowJoinInProgress = true;
+	HostSettings.bShouldAdvertise = true;
+	HostSettings.Set(SETTING_MAPNAME, FString("Map_SandBox"), EOnlineDataAdvertisementType::ViaOnlineService);
+
+	//the created session answers searches as soon as the call returns for LAN, no need to wait for the delegate
+	return HostSessions->CreateSession(0, NAME_GameSession, HostSettings);
+}
+
+void FNetWorkLoadGenerator::DestroyHost()
+{
+	if (!HostSessions.IsValid()) {
+		return;
+	}
+
+	HostSessions->DestroySession(NAME_GameSession);
+	HostSessions.Reset();
+
+	if (FOnlineSubsystemModule *OnlineModule = FModuleManager::GetModulePtr<FOnlineSubsystemModule>("OnlineSubsystem")) {
+		OnlineModule->DestroyOnlineSubsystem(HostInstanceName);
+	}
+}
+
+void FNetWorkLoadGenerator::LogReport() const
+{
+	const double Elapsed = (bRunning ? FPlatformTime::Seconds() : StopTime) - StartTime;
+	const int32 Completed = CycleStats.LatenciesMs.Num();
+	const int32 Attempted = Completed + CycleStats.Errors;
+
+	UE_LOG(LogNetWorkSubsystem, Display, TEXT("LoadGen: %d clients, %.1f s, %d cycles completed (%.2f cycles/s), error rate %.1f%%"),
+		Clients.Num(), Elapsed, Completed, Elapsed > 0.0 ? Completed / Elapsed : 0.0, Attempted > 0 ? 100.0 * CycleStats.Errors / Attempted : 0.0);
+
+	LogStats(TEXT("Find"), FindStats);
+	LogStats(TEXT("Join"), JoinStats);
+	LogStats(TEXT("Leave"), LeaveStats);
+	LogStats(TEXT("Cycle"), CycleStats);
+}
+
+void FNetWorkLoadGenerator::LogStats(const TCHAR* Name, const FOperationStats& Stats)
+{
+	if (Stats.LatenciesMs.Num() == 0) {
+		UE_LOG(LogNetWorkSubsystem, Display, TEXT("LoadGen: %-5s no successful operations, %d errors"), Name, Stats.Errors);
+		return;
+	}
+
+	TArray<float> Sorted = Stats.LatenciesMs;
+	Sorted.Sort();
+
+	auto Percentile = [&Sorted](float P) {
+		const int32 Index = FMath::Clamp(FMath::CeilToInt(P * Sorted.Num()) - 1, 0, Sorted.Num() - 1);
+		return Sorted[Index];
+	};
+
+	UE_LOG(LogNetWorkSubsystem, Display, TEXT("LoadGen: %-5s ok %d  errors %d  p50 %.2f ms  p90 %.2f ms  p99 %.2f ms  max %.2f ms"),
+		Name, Sorted.Num(), Stats.Errors, Percentile(0.50f), Percentile(0.90f), Percentile(0.99f), Sorted.Last());
+}
@@ -0,0 +1,236 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NetWorkSessionEmulator.h"
+#include "OnlineSessionSettings.h"
+#include "Containers/Ticker.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarSessionEmuEnable(
+	TEXT("net.SessionEmu.Enable"),
+	0,
+	TEXT("Emulate backend latency, jitter, failures and result inflation for session calls made by NetWorkSubsystem."));
+
+static TAutoConsoleVariable<float> CVarSessionEmuLatencyMs(
+	TEXT("net.SessionEmu.LatencyMs"),
+	0.0f,
+	TEXT("Milliseconds before an emulated session call reaches the session interface."));
+
+static TAutoConsoleVariable<float> CVarSessionEmuJitterMs(
+	TEXT("net.SessionEmu.JitterMs"),
+	0.0f,
+	TEXT("Random extra milliseconds, 0..JitterMs, added to each emulated session call."));
+
+static TAutoConsoleVariable<float> CVarSessionEmuFailureRate(
+	TEXT("net.SessionEmu.FailureRate"),
+	0.0f,
+	TEXT("Chance 0..1 that an emulated session call fails through its completion delegate instead of reaching the session interface."));
+
+static TAutoConsoleVariable<int32> CVarSessionEmuResultInflation(
+	TEXT("net.SessionEmu.ResultInflation"),
+	1,
+	TEXT("Every search result is reported this many times while session emulation is enabled."));
+
+typedef TWeakPtr<IOnlineSession, ESPMode::ThreadSafe> FWeakOnlineSession;
+
+FNetWorkSessionEmulator::FNetWorkSessionEmulator(IOnlineSessionPtr InSessions)
+	: Sessions(InSessions)
+{
+}
+
+bool FNetWorkSessionEmulator::IsEnabled()
+{
+	return CVarSessionEmuEnable.GetValueOnGameThread() != 0;
+}
+
+bool FNetWorkSessionEmulator::Emulate(TFunction<bool()>&& Call, TFunction<void()>&& Fail)
+{
+	if (!IsEnabled()) {
+		return Call();
+	}
+
+	const float DelaySeconds = FMath::Max(0.0f, CVarSessionEmuLatencyMs.GetValueOnGameThread() + FMath::FRand() * CVarSessionEmuJitterMs.GetValueOnGameThread()) / 1000.0f;
+	const bool bFail = FMath::FRand() < CVarSessionEmuFailureRate.GetValueOnGameThread();
+
+	if (DelaySeconds <= 0.0f && !bFail) {
+		return Call();
+	}
+
+	//the call is accepted now and answered later, like a real backend round trip
+	FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([Call = MoveTemp(Call), Fail = MoveTemp(Fail), bFail](float DeltaTime) {
+		//a call the interface rejects after the delay still has to answer through its delegate
+		if (bFail || !Call()) {
+			Fail();
+		}
+		return false;
+	}), DelaySeconds);
+
+	return true;
+}
+
+bool FNetWorkSessionEmulator::CreateSession(const FUniqueNetId& HostingPlayerId, FName SessionName, const FOnlineSessionSettings& NewSessionSettings)
+{
+	FWeakOnlineSession Weak = Sessions;
+	FUniqueNetIdRef PlayerId = HostingPlayerId.AsShared();
+	FOnlineSessionSettings Settings = NewSessionSettings;
+
+	return Emulate([Weak, PlayerId, SessionName, Settings]() {
+		IOnlineSessionPtr Pinned = Weak.Pin();
+		return Pinned.IsValid() && Pinned->CreateSession(*PlayerId, SessionName, Settings);
+	}, [Weak, SessionName]() {
+		if (IOnlineSessionPtr Pinned = Weak.Pin()) {
+			Pinned->TriggerOnCreateSessionCompleteDelegates(SessionName, false);
+		}
+	});
+}
+
+bool FNetWorkSessionEmulator::CreateSession(int32 HostingPlayerNum, FName SessionName, const FOnlineSessionSettings& NewSessionSettings)
+{
+	FWeakOnlineSession Weak = Sessions;
+	FOnlineSessionSettings Settings = NewSessionSettings;
+
+	return Emulate([Weak, HostingPlayerNum, SessionName, Settings]() {
+		IOnlineSessionPtr Pinned = Weak.Pin();
+		return Pinned.IsValid() && Pinned->CreateSession(HostingPlayerNum, SessionName, Settings);
+	}, [Weak, SessionName]() {
+		if (IOnlineSessionPtr Pinned = Weak.Pin()) {
+			Pinned->TriggerOnCreateSessionCompleteDelegates(SessionName, false);
+		}
+	});
+}
+
+bool FNetWorkSessionEmulator::StartSession(FName SessionName)
+{
+	FWeakOnlineSession Weak = Sessions;
+
+	return Emulate([Weak, SessionName]() {
+		IOnlineSessionPtr Pinned = Weak.Pin();
+		return Pinned.IsValid() && Pinned->StartSession(SessionName);
+	}, [Weak, SessionName]() {
+		if (IOnlineSessionPtr Pinned = Weak.Pin()) {
+			Pinned->TriggerOnStartSessionCompleteDelegates(SessionName, false);
+		}
+	});
+}
+
+bool FNetWorkSessionEmulator::FindSessions(const FUniqueNetId& SearchingPlayerId, const TSharedRef<FOnlineSessionSearch>& SearchSettings)
+{
+	FWeakOnlineSession Weak = Sessions;
+	FUniqueNetIdRef PlayerId = SearchingPlayerId.AsShared();
+	TSharedRef<FOnlineSessionSearch> Search = SearchSettings;
+
+	//callers check the search state while the emulated call is still waiting
+	if (IsEnabled()) {
+		Search->SearchState = EOnlineAsyncTaskState::InProgress;
+	}
+
+	return Emulate([Weak, PlayerId, Search]() {
+		IOnlineSessionPtr Pinned = Weak.Pin();
+		Search->SearchState = EOnlineAsyncTaskState::NotStarted;
+		return Pinned.IsValid() && Pinned->FindSessions(*PlayerId, Search);
+	}, [Weak, Search]() {
+		Search->SearchState = EOnlineAsyncTaskState::Failed;
+		if (IOnlineSessionPtr Pinned = Weak.Pin()) {
+			Pinned->TriggerOnFindSessionsCompleteDelegates(false);
+		}
+	});
+}
+
+bool FNetWorkSessionEmulator::FindSessions(int32 SearchingPlayerNum, const TSharedRef<FOnlineSessionSearch>& SearchSettings)
+{
+	FWeakOnlineSession Weak = Sessions;
+	TSharedRef<FOnlineSessionSearch> Search = SearchSettings;
+
+	if (IsEnabled()) {
+		Search->SearchState = EOnlineAsyncTaskState::InProgress;
+	}
+
+	return Emulate([Weak, SearchingPlayerNum, Search]() {
+		IOnlineSessionPtr Pinned = Weak.Pin();
+		Search->SearchState = EOnlineAsyncTaskState::NotStarted;
+		return Pinned.IsValid() && Pinned->FindSessions(SearchingPlayerNum, Search);
+	}, [Weak, Search]() {
+		Search->SearchState = EOnlineAsyncTaskState::Failed;
+		if (IOnlineSessionPtr Pinned = Weak.Pin()) {
+			Pinned->TriggerOnFindSessionsCompleteDelegates(false);
+		}
+	});
+}
+
+bool FNetWorkSessionEmulator::JoinSession(const FUniqueNetId& PlayerId, FName SessionName, const FOnlineSessionSearchResult& DesiredSession)
+{
+	FWeakOnlineSession Weak = Sessions;
+	FUniqueNetIdRef Player = PlayerId.AsShared();
+	FOnlineSessionSearchResult Result = DesiredSession;
+
+	return Emulate([Weak, Player, SessionName, Result]() {
+		IOnlineSessionPtr Pinned = Weak.Pin();
+		return Pinned.IsValid() && Pinned->JoinSession(*Player, SessionName, Result);
+	}, [Weak, SessionName]() {
+		if (IOnlineSessionPtr Pinned = Weak.Pin()) {
+			Pinned->TriggerOnJoinSessionCompleteDelegates(SessionName, EOnJoinSessionCompleteResult::UnknownError);
+		}
+	});
+}
+
+bool FNetWorkSessionEmulator::JoinSession(int32 PlayerNum, FName SessionName, const FOnlineSessionSearchResult& DesiredSession)
+{
+	FWeakOnlineSession Weak = Sessions;
+	FOnlineSessionSearchResult Result = DesiredSession;
+
+	return Emulate([Weak, PlayerNum, SessionName, Result]() {
+		IOnlineSessionPtr Pinned = Weak.Pin();
+		return Pinned.IsValid() && Pinned->JoinSession(PlayerNum, SessionName, Result);
+	}, [Weak, SessionName]() {
+		if (IOnlineSessionPtr Pinned = Weak.Pin()) {
+			Pinned->TriggerOnJoinSessionCompleteDelegates(SessionName, EOnJoinSessionCompleteResult::UnknownError);
+		}
+	});
+}
+
+bool FNetWorkSessionEmulator::UpdateSession(FName SessionName, FOnlineSessionSettings& UpdatedSessionSettings, bool bShouldRefreshOnlineData)
+{
+	FWeakOnlineSession Weak = Sessions;
+	FOnlineSessionSettings Settings = UpdatedSessionSettings;
+
+	return Emulate([Weak, SessionName, Settings, bShouldRefreshOnlineData]() mutable {
+		IOnlineSessionPtr Pinned = Weak.Pin();
+		return Pinned.IsValid() && Pinned->UpdateSession(SessionName, Settings, bShouldRefreshOnlineData);
+	}, [Weak, SessionName]() {
+		if (IOnlineSessionPtr Pinned = Weak.Pin()) {
+			Pinned->TriggerOnUpdateSessionCompleteDelegates(SessionName, false);
+		}
+	});
+}
+
+bool FNetWorkSessionEmulator::DestroySession(FName SessionName)
+{
+	FWeakOnlineSession Weak = Sessions;
+
+	return Emulate([Weak, SessionName]() {
+		IOnlineSessionPtr Pinned = Weak.Pin();
+		return Pinned.IsValid() && Pinned->DestroySession(SessionName);
+	}, [Weak, SessionName]() {
+		if (IOnlineSessionPtr Pinned = Weak.Pin()) {
+			Pinned->TriggerOnDestroySessionCompleteDelegates(SessionName, false);
+		}
+	});
+}
+
+void FNetWorkSessionEmulator::InflateSearchResults(FOnlineSessionSearch& Search)
+{
+	const int32 Inflation = CVarSessionEmuResultInflation.GetValueOnGameThread();
+
+	if (!IsEnabled() || Inflation <= 1) {
+		return;
+	}
+
+	const int32 NumOriginal = Search.SearchResults.Num();
+	Search.SearchResults.Reserve(NumOriginal * Inflation);
+
+	for (int32 Copy = 1; Copy < Inflation; Copy++) {
+		for (int32 i = 0; i < NumOriginal; i++) {
+			Search.SearchResults.Add(Search.SearchResults[i]);
+		}
+	}
+}
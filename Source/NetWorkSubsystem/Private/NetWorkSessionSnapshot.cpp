@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NetWorkSessionSnapshot.h"
+
+FNetWorkSessionSnapshotPublisher::FNetWorkSessionSnapshotPublisher()
+	: Current(new FNetWorkSessionSnapshot())
+	, ActiveReaders(0)
+	, PublishedVersion(0)
+{
+}
+
+FNetWorkSessionSnapshotPublisher::~FNetWorkSessionSnapshotPublisher()
+{
+	//readers must be done with the owner before it goes away
+	check(ActiveReaders.load() == 0);
+
+	delete Current.load();
+	for (const FNetWorkSessionSnapshot *Snapshot : Retired) {
+		delete Snapshot;
+	}
+}
+
+void FNetWorkSessionSnapshotPublisher::Publish(FNetWorkSessionSnapshot&& Snapshot)
+{
+	check(IsInGameThread());
+
+	const uint64 Version = PublishedVersion.load(std::memory_order_relaxed) + 1;
+
+	FNetWorkSessionSnapshot *Published = new FNetWorkSessionSnapshot(MoveTemp(Snapshot));
+	Published->Version = Version;
+	Published->PublishTime = FPlatformTime::Seconds();
+
+	//the snapshot is fully built before it becomes visible
+	Retired.Add(Current.exchange(Published));
+	PublishedVersion.store(Version, std::memory_order_release);
+
+	Reclaim();
+}
+
+FNetWorkSessionSnapshot FNetWorkSessionSnapshotPublisher::Get() const
+{
+	//announce the read before loading the pointer, so Reclaim cannot free it under us
+	ActiveReaders.fetch_add(1);
+	FNetWorkSessionSnapshot Copy = *Current.load();
+	ActiveReaders.fetch_sub(1);
+
+	return Copy;
+}
+
+void FNetWorkSessionSnapshotPublisher::Reclaim()
+{
+	//every retired snapshot was swapped out before this check, a reader that announced itself afterwards
+	//can only have loaded the new one, so with no reader active none of them is still in use
+	if (Retired.Num() == 0 || ActiveReaders.load() != 0) {
+		return;
+	}
+
+	for (const FNetWorkSessionSnapshot *Snapshot : Retired) {
+		delete Snapshot;
+	}
+	Retired.Reset();
+}
@@ -0,0 +1,272 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NetWorkSessionTrace.h"
+#include "NetWorkSubsystem.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+#include "Misc/DateTime.h"
+#include "Serialization/Archive.h"
+
+static TAutoConsoleVariable<int32> CVarSessionTraceEnable(
+	TEXT("net.SessionTrace.Enable"),
+	1,
+	TEXT("Record session calls, callbacks, state changes and network errors into the session trace ring buffer."));
+
+static TAutoConsoleVariable<int32> CVarSessionTraceCapacity(
+	TEXT("net.SessionTrace.Capacity"),
+	4096,
+	TEXT("Number of events kept in the session trace ring buffer. Read when the buffer is first used or reset."));
+
+static TAutoConsoleVariable<int32> CVarSessionTraceDumpOnError(
+	TEXT("net.SessionTrace.DumpOnError"),
+	1,
+	TEXT("Write the session trace to Saved/SessionTraces whenever a session operation fails or a network error is handled."));
+
+static TAutoConsoleVariable<float> CVarSessionTraceDumpInterval(
+	TEXT("net.SessionTrace.DumpOnErrorInterval"),
+	30.0f,
+	TEXT("Minimum seconds between two traces written because of errors, failures in a burst are covered by the first file."));
+
+static TAutoConsoleVariable<int32> CVarSessionTraceMaxFiles(
+	TEXT("net.SessionTrace.MaxFiles"),
+	20,
+	TEXT("Number of trace files kept in Saved/SessionTraces, the oldest are deleted when a new one is written. 0 keeps all of them."));
+
+//file layout: magic, version, seconds per cycle, reason, event count, events
+static const uint32 SessionTraceMagic = 0x5453574E; // "NWST"
+static const uint32 SessionTraceVersion = 1;
+
+static void SerializeTraceEvent(FArchive& Ar, FNetWorkTraceEvent& Event)
+{
+	Ar << Event.Cycles;
+	Ar << Event.Type;
+	Ar << Event.Code;
+	Ar << Event.Result;
+	Ar << Event.Detail;
+}
+
+FNetWorkSessionTrace::FNetWorkSessionTrace()
+{
+	Head = 0;
+	NumRecorded = 0;
+	LastErrorDumpTime = 0.0;
+}
+
+void FNetWorkSessionTrace::Record(ENetWorkTraceEventType Type, uint8 Code, uint8 Result, int32 Detail)
+{
+	if (CVarSessionTraceEnable.GetValueOnGameThread() == 0) {
+		return;
+	}
+
+	if (Events.Num() == 0) {
+		LLM_SCOPE_BYTAG(NetWorkSubsystem_Trace);
+		Events.SetNumZeroed(FMath::Max(CVarSessionTraceCapacity.GetValueOnGameThread(), 16));
+		Head = 0;
+	}
+
+	FNetWorkTraceEvent &Event = Events[Head];
+	Event.Cycles = FPlatformTime::Cycles64();
+	Event.Type = (uint8)Type;
+	Event.Code = Code;
+	Event.Result = Result;
+	Event.Padding = 0;
+	Event.Detail = Detail;
+
+	Head = (Head + 1) % Events.Num();
+	NumRecorded++;
+}
+
+void FNetWorkSessionTrace::GetEvents(TArray<FNetWorkTraceEvent>& OutEvents) const
+{
+	OutEvents.Reset();
+
+	if (Events.Num() == 0) {
+		return;
+	}
+
+	//before the buffer wraps the oldest event is at 0, afterwards it is at Head
+	const int32 Count = (int32)FMath::Min<uint64>(NumRecorded, (uint64)Events.Num());
+	const int32 First = NumRecorded > (uint64)Events.Num() ? Head : 0;
+
+	OutEvents.Reserve(Count);
+	for (int32 i = 0; i < Count; i++) {
+		OutEvents.Add(Events[(First + i) % Events.Num()]);
+	}
+}
+
+void FNetWorkSessionTrace::Reset()
+{
+	Events.Empty();
+	Head = 0;
+	NumRecorded = 0;
+}
+
+FString FNetWorkSessionTrace::Dump(const FString& Reason)
+{
+	TArray<FNetWorkTraceEvent> Ordered;
+	GetEvents(Ordered);
+
+	const FString FileName = FPaths::ProjectSavedDir() / TEXT("SessionTraces") / FString::Printf(TEXT("SessionTrace-%s.bin"), *FDateTime::Now().ToString(TEXT("%Y%m%d-%H%M%S-%s")));
+
+	FArchive *Writer = IFileManager::Get().CreateFileWriter(*FileName);
+	if (!Writer) {
+		UE_LOG(LogNetWorkSubsystem, Warning, TEXT("Could not write session trace to %s"), *FileName);
+		return FString();
+	}
+
+	uint32 Magic = SessionTraceMagic;
+	uint32 Version = SessionTraceVersion;
+	double SecondsPerCycle = FPlatformTime::GetSecondsPerCycle64();
+	FString ReasonCopy = Reason;
+	int32 Num = Ordered.Num();
+
+	*Writer << Magic;
+	*Writer << Version;
+	*Writer << SecondsPerCycle;
+	*Writer << ReasonCopy;
+	*Writer << Num;
+	for (auto &Event : Ordered) {
+		SerializeTraceEvent(*Writer, Event);
+	}
+
+	const bool bSuccess = Writer->Close();
+	delete Writer;
+
+	if (!bSuccess) {
+		UE_LOG(LogNetWorkSubsystem, Warning, TEXT("Could not write session trace to %s"), *FileName);
+		return FString();
+	}
+
+	UE_LOG(LogNetWorkSubsystem, Log, TEXT("Wrote %d session trace events to %s (%s)"), Num, *FileName, *Reason);
+
+	DeleteOldTraceFiles();
+	return FileName;
+}
+
+void FNetWorkSessionTrace::DumpOnError(const FString& Reason)
+{
+	if (CVarSessionTraceDumpOnError.GetValueOnGameThread() == 0 || NumRecorded == 0) {
+		return;
+	}
+
+	//a backend that is down fails every operation, one file already holds the whole burst
+	const double Now = FPlatformTime::Seconds();
+	if (LastErrorDumpTime > 0.0 && Now - LastErrorDumpTime < CVarSessionTraceDumpInterval.GetValueOnGameThread()) {
+		UE_LOG(LogNetWorkSubsystem, Verbose, TEXT("Session trace not written for %s, last one was %.1f s ago"), *Reason, Now - LastErrorDumpTime);
+		return;
+	}
+
+	LastErrorDumpTime = Now;
+	Dump(Reason);
+}
+
+void FNetWorkSessionTrace::DeleteOldTraceFiles()
+{
+	const int32 MaxFiles = CVarSessionTraceMaxFiles.GetValueOnGameThread();
+	if (MaxFiles <= 0) {
+		return;
+	}
+
+	const FString TraceDir = FPaths::ProjectSavedDir() / TEXT("SessionTraces");
+	TArray<FString> TraceFiles;
+	IFileManager::Get().FindFiles(TraceFiles, *(TraceDir / TEXT("SessionTrace-*.bin")), true, false);
+
+	//the names carry the time they were written, so sorting by name puts the oldest first
+	TraceFiles.Sort();
+	for (int32 i = 0; i < TraceFiles.Num() - MaxFiles; i++) {
+		IFileManager::Get().Delete(*(TraceDir / TraceFiles[i]));
+	}
+}
+
+bool FNetWorkSessionTrace::LoadFromFile(const FString& FileName, TArray<FNetWorkTraceEvent>& OutEvents, double& OutSecondsPerCycle, FString& OutReason)
+{
+	OutEvents.Reset();
+
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*FileName));
+	if (!Reader) {
+		return false;
+	}
+
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	int32 Num = 0;
+
+	*Reader << Magic;
+	*Reader << Version;
+	if (Magic != SessionTraceMagic || Version != SessionTraceVersion) {
+		return false;
+	}
+
+	*Reader << OutSecondsPerCycle;
+	*Reader << OutReason;
+	*Reader << Num;
+
+	//a truncated or corrupt count would otherwise allocate an absurd array
+	const int64 EventSize = sizeof(uint64) + 3 * sizeof(uint8) + sizeof(int32);
+	if (Num < 0 || Num * EventSize > Reader->TotalSize() - Reader->Tell()) {
+		return false;
+	}
+
+	OutEvents.SetNumZeroed(Num);
+	for (auto &Event : OutEvents) {
+		SerializeTraceEvent(*Reader, Event);
+	}
+
+	return !Reader->IsError();
+}
+
+const TCHAR* FNetWorkSessionTrace::GetEventTypeName(uint8 Type)
+{
+	switch ((ENetWorkTraceEventType)Type) {
+	case ENetWorkTraceEventType::ESessionCall:		return TEXT("Call");
+	case ENetWorkTraceEventType::ESessionCallback:	return TEXT("Callback");
+	case ENetWorkTraceEventType::EStateChange:		return TEXT("ChangeState");
+	case ENetWorkTraceEventType::EStateEnter:		return TEXT("EnterState");
+	case ENetWorkTraceEventType::EStateLeave:		return TEXT("LeaveState");
+	case ENetWorkTraceEventType::ENetworkError:		return TEXT("NetworkError");
+	case ENetWorkTraceEventType::ESessionAbandoned:	return TEXT("Abandoned");
+	default:										return TEXT("Unknown");
+	}
+}
+
+const TCHAR* FNetWorkSessionTrace::GetStageName(uint8 Stage)
+{
+	switch ((ESessionStage)Stage) {
+	case ESessionStage::ECreate:	return TEXT("Create");
+	case ESessionStage::EStart:		return TEXT("Start");
+	case ESessionStage::EFind:		return TEXT("Find");
+	case ESessionStage::EJoin:		return TEXT("Join");
+	case ESessionStage::EUpdate:	return TEXT("Update");
+	case ESessionStage::EDestroy:	return TEXT("Destroy");
+	default:						return TEXT("Unknown");
+	}
+}
+
+const TCHAR* FNetWorkSessionTrace::GetAbandonReasonName(uint8 Reason)
+{
+	switch ((ENetWorkTraceAbandonReason)Reason) {
+	case ENetWorkTraceAbandonReason::ERejected:	return TEXT("rejected by the session interface");
+	case ENetWorkTraceAbandonReason::ETimedOut:	return TEXT("timed out");
+	case ENetWorkTraceAbandonReason::ECancelled:	return TEXT("cancelled");
+	default:									return TEXT("abandoned");
+	}
+}
+
+const TCHAR* FNetWorkSessionTrace::GetStateName(uint8 State)
+{
+	switch ((EGameState)State) {
+	case EGameState::ENone:					return TEXT("None");
+	case EGameState::ELoadingScreen:		return TEXT("Loading");
+	case EGameState::EStartup:				return TEXT("Startup");
+	case EGameState::EMainMenu:				return TEXT("Main Menu");
+	case EGameState::EMultiplayerHome:		return TEXT("Multiplayer Home");
+	case EGameState::EMultiplayerJoin:		return TEXT("Multiplayer Join");
+	case EGameState::EMultiplayerHost:		return TEXT("Multiplayer Host");
+	case EGameState::EMultiplayerInGame:	return TEXT("Multiplayer In Game");
+	case EGameState::ETravelling:			return TEXT("Travelling");
+	case EGameState::ENetworkError:			return TEXT("Network Error");
+	default:								return TEXT("Unknown");
+	}
+}
@@ -0,0 +1,238 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NetWorkSessionTraceCommandlet.h"
+#include "NetWorkSessionTrace.h"
+#include "NetWorkSubsystem.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+#include "Misc/Parse.h"
+
+UNetWorkSessionTraceCommandlet::UNetWorkSessionTraceCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UNetWorkSessionTraceCommandlet::Main(const FString& Params)
+{
+	FString TraceFile;
+
+	//no file given, take the newest trace in Saved/SessionTraces
+	if (!FParse::Value(*Params, TEXT("Trace="), TraceFile)) {
+		const FString TraceDir = FPaths::ProjectSavedDir() / TEXT("SessionTraces");
+		TArray<FString> Files;
+		IFileManager::Get().FindFiles(Files, *(TraceDir / TEXT("*.bin")), true, false);
+
+		FDateTime Newest = FDateTime::MinValue();
+		for (auto &File : Files) {
+			const FDateTime Stamp = IFileManager::Get().GetTimeStamp(*(TraceDir / File));
+			if (Stamp > Newest) {
+				Newest = Stamp;
+				TraceFile = TraceDir / File;
+			}
+		}
+	}
+
+	if (TraceFile.IsEmpty()) {
+		UE_LOG(LogNetWorkSubsystem, Error, TEXT("No session trace found, pass -Trace=<file>"));
+		return 1;
+	}
+
+	TArray<FNetWorkTraceEvent> Events;
+	double SecondsPerCycle = 0.0;
+	FString Reason;
+
+	if (!FNetWorkSessionTrace::LoadFromFile(TraceFile, Events, SecondsPerCycle, Reason)) {
+		UE_LOG(LogNetWorkSubsystem, Error, TEXT("Could not read session trace %s"), *TraceFile);
+		return 1;
+	}
+
+	UE_LOG(LogNetWorkSubsystem, Display, TEXT("Session trace %s: %d events, dumped because: %s"), *TraceFile, Events.Num(), *Reason);
+
+	if (Events.Num() == 0) {
+		return 0;
+	}
+
+	if (FParse::Param(*Params, TEXT("Replay"))) {
+		Replay(Events, SecondsPerCycle);
+	}
+	if (FParse::Param(*Params, TEXT("Summary")) || !FParse::Param(*Params, TEXT("Replay"))) {
+		Summarise(Events, SecondsPerCycle);
+	}
+
+	return 0;
+}
+
+void UNetWorkSessionTraceCommandlet::Replay(const TArray<FNetWorkTraceEvent>& Events, double SecondsPerCycle)
+{
+	const uint64 FirstCycles = Events[0].Cycles;
+
+	for (auto &Event : Events) {
+		const double Ms = (double)(Event.Cycles - FirstCycles) * SecondsPerCycle * 1000.0;
+		const ENetWorkTraceEventType Type = (ENetWorkTraceEventType)Event.Type;
+
+		FString What;
+		switch (Type) {
+		case ENetWorkTraceEventType::ESessionCall:
+			What = FString::Printf(TEXT("%s %s"), FNetWorkSessionTrace::GetStageName(Event.Code), Event.Result ? TEXT("issued") : TEXT("rejected"));
+			break;
+		case ENetWorkTraceEventType::ESessionCallback:
+			What = FString::Printf(TEXT("%s %s (%d)"), FNetWorkSessionTrace::GetStageName(Event.Code), Event.Result ? TEXT("succeeded") : TEXT("failed"), Event.Detail);
+			break;
+		case ENetWorkTraceEventType::EStateChange:
+			What = FString::Printf(TEXT("%s -> %s"), FNetWorkSessionTrace::GetStateName((uint8)Event.Detail), FNetWorkSessionTrace::GetStateName(Event.Code));
+			break;
+		case ENetWorkTraceEventType::EStateEnter:
+		case ENetWorkTraceEventType::EStateLeave:
+			What = FNetWorkSessionTrace::GetStateName(Event.Code);
+			break;
+		case ENetWorkTraceEventType::ENetworkError:
+			What = FString::Printf(TEXT("%s failure type %d"), Event.Code ? TEXT("travel") : TEXT("network"), Event.Detail);
+			break;
+		case ENetWorkTraceEventType::ESessionAbandoned:
+			What = FString::Printf(TEXT("%s %s"), FNetWorkSessionTrace::GetStageName(Event.Code), FNetWorkSessionTrace::GetAbandonReasonName((uint8)Event.Detail));
+			break;
+		default:
+			break;
+		}
+
+		UE_LOG(LogNetWorkSubsystem, Display, TEXT("%10.3f ms  %-12s %s"), Ms, FNetWorkSessionTrace::GetEventTypeName(Event.Type), *What);
+	}
+}
+
+void UNetWorkSessionTraceCommandlet::Summarise(const TArray<FNetWorkTraceEvent>& Events, double SecondsPerCycle)
+{
+	const uint64 FirstCycles = Events[0].Cycles;
+	auto ToMs = [FirstCycles, SecondsPerCycle](uint64 Cycles) {
+		return (double)(Cycles - FirstCycles) * SecondsPerCycle * 1000.0;
+	};
+
+	//per-stage statistics, calls are matched to the next callback of the same stage in order
+	struct FStageStats {
+		TArray<double> PendingCalls;
+		int32 Completed = 0;
+		int32 Failed = 0;
+		int32 Rejected = 0;
+		int32 TimedOut = 0;
+		int32 Cancelled = 0;
+		double TotalMs = 0.0;
+		double MinMs = TNumericLimits<double>::Max();
+		double MaxMs = 0.0;
+	};
+	FStageStats Stages[(int32)ESessionStage::EDestroy + 1];
+	const int32 NumStages = UE_ARRAY_COUNT(Stages);
+
+	//state currently entered and when
+	int32 OpenState = -1;
+	double OpenStateMs = 0.0;
+
+	UE_LOG(LogNetWorkSubsystem, Display, TEXT("---- Timeline ----"));
+
+	for (auto &Event : Events) {
+		const double Ms = ToMs(Event.Cycles);
+
+		switch ((ENetWorkTraceEventType)Event.Type) {
+		case ENetWorkTraceEventType::ESessionCall: {
+			if (Event.Code >= NumStages) {
+				break;
+			}
+			if (Event.Result) {
+				Stages[Event.Code].PendingCalls.Add(Ms);
+			}
+			else {
+				Stages[Event.Code].Rejected++;
+				UE_LOG(LogNetWorkSubsystem, Display, TEXT("%10.3f ms  %s rejected by the session interface"), Ms, FNetWorkSessionTrace::GetStageName(Event.Code));
+			}
+			break;
+		}
+		case ENetWorkTraceEventType::ESessionCallback: {
+			if (Event.Code >= NumStages) {
+				break;
+			}
+			FStageStats &Stage = Stages[Event.Code];
+
+			//a callback without a recorded call started before the buffer wrapped
+			if (Stage.PendingCalls.Num() == 0) {
+				break;
+			}
+			const double StartMs = Stage.PendingCalls[0];
+			Stage.PendingCalls.RemoveAt(0);
+
+			const double Duration = Ms - StartMs;
+			Stage.Completed++;
+			Stage.Failed += Event.Result ? 0 : 1;
+			Stage.TotalMs += Duration;
+			Stage.MinMs = FMath::Min(Stage.MinMs, Duration);
+			Stage.MaxMs = FMath::Max(Stage.MaxMs, Duration);
+
+			UE_LOG(LogNetWorkSubsystem, Display, TEXT("%10.3f ms  %-8s %10.3f ms  %s"), StartMs, FNetWorkSessionTrace::GetStageName(Event.Code), Duration, Event.Result ? TEXT("ok") : TEXT("FAILED"));
+			break;
+		}
+		case ENetWorkTraceEventType::EStateEnter: {
+			if (OpenState > 0) {
+				UE_LOG(LogNetWorkSubsystem, Display, TEXT("%10.3f ms  state %-20s %10.3f ms"), OpenStateMs, FNetWorkSessionTrace::GetStateName((uint8)OpenState), Ms - OpenStateMs);
+			}
+			//LeaveState passes through None on every change, it is not worth reporting
+			OpenState = Event.Code;
+			OpenStateMs = Ms;
+			break;
+		}
+		case ENetWorkTraceEventType::ENetworkError: {
+			UE_LOG(LogNetWorkSubsystem, Display, TEXT("%10.3f ms  %s error, failure type %d"), Ms, Event.Code ? TEXT("travel") : TEXT("network"), Event.Detail);
+			break;
+		}
+		case ENetWorkTraceEventType::ESessionAbandoned: {
+			if (Event.Code >= NumStages || Stages[Event.Code].PendingCalls.Num() == 0) {
+				break;
+			}
+			FStageStats &Stage = Stages[Event.Code];
+
+			//a rejection answers the call recorded right before it, a timeout or cancel the oldest one still out
+			const ENetWorkTraceAbandonReason Reason = (ENetWorkTraceAbandonReason)Event.Detail;
+			double StartMs = 0.0;
+			if (Reason == ENetWorkTraceAbandonReason::ERejected) {
+				StartMs = Stage.PendingCalls.Pop();
+				Stage.Rejected++;
+			}
+			else {
+				StartMs = Stage.PendingCalls[0];
+				Stage.PendingCalls.RemoveAt(0);
+				Stage.TimedOut += Reason == ENetWorkTraceAbandonReason::ETimedOut ? 1 : 0;
+				Stage.Cancelled += Reason == ENetWorkTraceAbandonReason::ECancelled ? 1 : 0;
+			}
+
+			UE_LOG(LogNetWorkSubsystem, Display, TEXT("%10.3f ms  %-8s %10.3f ms  %s"), StartMs, FNetWorkSessionTrace::GetStageName(Event.Code), Ms - StartMs, FNetWorkSessionTrace::GetAbandonReasonName((uint8)Event.Detail));
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	const double EndMs = ToMs(Events.Last().Cycles);
+	if (OpenState > 0) {
+		UE_LOG(LogNetWorkSubsystem, Display, TEXT("%10.3f ms  state %-20s %10.3f ms (still active)"), OpenStateMs, FNetWorkSessionTrace::GetStateName((uint8)OpenState), EndMs - OpenStateMs);
+	}
+
+	UE_LOG(LogNetWorkSubsystem, Display, TEXT("---- Stages ----"));
+	for (int32 i = 0; i < NumStages; i++) {
+		const FStageStats &Stage = Stages[i];
+
+		if (Stage.Completed == 0 && Stage.Rejected == 0 && Stage.TimedOut == 0 && Stage.Cancelled == 0 && Stage.PendingCalls.Num() == 0) {
+			continue;
+		}
+
+		UE_LOG(LogNetWorkSubsystem, Display, TEXT("%-8s completed %d (failed %d, rejected %d, timed out %d, cancelled %d)  min %.3f ms  avg %.3f ms  max %.3f ms"),
+			FNetWorkSessionTrace::GetStageName((uint8)i), Stage.Completed, Stage.Failed, Stage.Rejected, Stage.TimedOut, Stage.Cancelled,
+			Stage.Completed ? Stage.MinMs : 0.0, Stage.Completed ? Stage.TotalMs / Stage.Completed : 0.0, Stage.MaxMs);
+
+		//these are the calls a player would be stuck on
+		for (double StartMs : Stage.PendingCalls) {
+			UE_LOG(LogNetWorkSubsystem, Display, TEXT("%-8s issued at %.3f ms never completed (%.3f ms before the trace ended)"),
+				FNetWorkSessionTrace::GetStageName((uint8)i), StartMs, EndMs - StartMs);
+		}
+	}
+}
@@ -1,9 +1,18 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "NetWorkSubsystem.h"
+#include "NetWorkLoadGenerator.h"
 
 #define LOCTEXT_NAMESPACE "FNetWorkSubsystemModule"
 
+DEFINE_LOG_CATEGORY(LogNetWorkSubsystem);
+
+LLM_DEFINE_TAG(NetWorkSubsystem);
+LLM_DEFINE_TAG(NetWorkSubsystem_SearchResults, TEXT("NetWorkSubsystem/SearchResults"), TEXT("NetWorkSubsystem"));
+LLM_DEFINE_TAG(NetWorkSubsystem_SessionSettings, TEXT("NetWorkSubsystem/SessionSettings"), TEXT("NetWorkSubsystem"));
+LLM_DEFINE_TAG(NetWorkSubsystem_Widgets, TEXT("NetWorkSubsystem/Widgets"), TEXT("NetWorkSubsystem"));
+LLM_DEFINE_TAG(NetWorkSubsystem_Trace, TEXT("NetWorkSubsystem/Trace"), TEXT("NetWorkSubsystem"));
+
 void FNetWorkSubsystemModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
@@ -13,6 +22,7 @@ void FNetWorkSubsystemModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	FNetWorkLoadGenerator::ShutdownConsoleGenerator();
 }
 
 #undef LOCTEXT_NAMESPACE
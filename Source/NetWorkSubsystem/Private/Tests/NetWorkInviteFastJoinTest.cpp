@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "NetWorkGameInstanceSubsystem.h"
+#include "NetWorkSessionTrace.h"
+#include "OnlineSubsystem.h"
+#include "OnlineSubsystemModule.h"
+#include "OnlineSessionSettings.h"
+#include "Modules/ModuleManager.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+
+//instance hosting the session the invite points at, next to the default one the subsystem joins with
+static const FName InviteTestHostInstance(TEXT("NULL:InviteFastJoinTestHost"));
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNetWorkInviteFastJoinTest, "NetWorkSubsystem.Invites.FastJoin",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FNetWorkInviteFastJoinTest::RunTest(const FString& Parameters)
+{
+	//the Null subsystem completes every call before it returns, which keeps the whole flow inside this test
+	IOnlineSubsystem *OnlineSub = IOnlineSubsystem::Get();
+	if (!OnlineSub || OnlineSub->GetSubsystemName() != NULL_SUBSYSTEM) {
+		AddInfo(TEXT("Skipped, the default online subsystem is not NULL"));
+		return true;
+	}
+
+	IOnlineIdentityPtr Identity = OnlineSub->GetIdentityInterface();
+	IOnlineSessionPtr Sessions = OnlineSub->GetSessionInterface();
+	IOnlineSubsystem *HostSub = IOnlineSubsystem::Get(InviteTestHostInstance);
+	IOnlineSessionPtr HostSessions = HostSub ? HostSub->GetSessionInterface() : IOnlineSessionPtr();
+	if (!TestTrue(TEXT("Null identity and session interfaces exist"), Identity.IsValid() && Sessions.IsValid() && HostSessions.IsValid())) {
+		return false;
+	}
+
+	//the subsystem joins as local player 0
+	const bool bWasLoggedIn = Identity->GetUniquePlayerId(0).IsValid();
+	if (!bWasLoggedIn) {
+		Identity->Login(0, FOnlineAccountCredentials(TEXT("Dummy"), TEXT("InviteFastJoinTest"), TEXT("")));
+	}
+
+	//host a LAN session on the second instance and build the invite from it
+	FOnlineSessionSettings HostSettings;
+	HostSettings.bIsLANMatch = true;
+	HostSettings.bUsesPresence = true;
+	HostSettings.bShouldAdvertise = true;
+	HostSettings.NumPublicConnections = 4;
+	HostSessions->CreateSession(0, NAME_GameSession, HostSettings);
+
+	FOnlineSessionSearchResult InviteResult;
+	if (FNamedOnlineSession *HostSession = HostSessions->GetNamedSession(NAME_GameSession)) {
+		InviteResult.Session = *HostSession;
+	}
+
+	//a game instance with its own world, and a player controller to travel with
+	UGameInstance *GameInstance = NewObject<UGameInstance>(GEngine);
+	GameInstance->InitializeStandalone();
+	UWorld *World = GameInstance->GetWorld();
+	World->SpawnActor<APlayerController>();
+
+	UNetWorkGameInstanceSubsystem *Subsystem = GameInstance->GetSubsystem<UNetWorkGameInstanceSubsystem>();
+
+	if (TestNotNull(TEXT("Subsystem"), Subsystem) && TestTrue(TEXT("Invite result is valid"), InviteResult.IsValid())) {
+		Subsystem->ChangeState(EGameState::EMainMenu);
+
+		//only the events of the invite, a wrapped ring buffer could not tell them apart otherwise
+		Subsystem->GetSessionTrace().Reset();
+
+		//what the platform overlay does when the player accepts
+		Sessions->TriggerOnSessionUserInviteAcceptedDelegates(true, 0, Identity->GetUniquePlayerId(0), InviteResult);
+
+		TestEqual(TEXT("State after accepting the invite"), (int32)Subsystem->GetCurrentGameState(), (int32)EGameState::ETravelling);
+		TestTrue(TEXT("LastInviteToTravelMs is set"), Subsystem->LastInviteToTravelMs >= 0.0f);
+		TestTrue(TEXT("Joined the invited session"), Sessions->GetNamedSession(NAME_GameSession) != nullptr);
+
+		//straight to travelling, LeaveState passes through None and none of the menu states are entered on the way
+		TArray<FNetWorkTraceEvent> Events;
+		Subsystem->GetSessionTrace().GetEvents(Events);
+
+		TArray<FString> StateEvents;
+		for (auto &Event : Events) {
+			if (Event.Type == (uint8)ENetWorkTraceEventType::EStateEnter || Event.Type == (uint8)ENetWorkTraceEventType::EStateLeave) {
+				StateEvents.Add(FString::Printf(TEXT("%s(%s)"), FNetWorkSessionTrace::GetEventTypeName(Event.Type), FNetWorkSessionTrace::GetStateName(Event.Code)));
+			}
+		}
+
+		const FString Expected = FString::Printf(TEXT("LeaveState(%s), EnterState(%s), EnterState(%s)"),
+			FNetWorkSessionTrace::GetStateName((uint8)EGameState::EMainMenu), FNetWorkSessionTrace::GetStateName((uint8)EGameState::ENone), FNetWorkSessionTrace::GetStateName((uint8)EGameState::ETravelling));
+		TestEqual(TEXT("State changes after accepting the invite"), FString::Join(StateEvents, TEXT(", ")), Expected);
+	}
+
+	//tear the game instance down before it gets to tick the pending client travel
+	GameInstance->Shutdown();
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+
+	if (Sessions->GetNamedSession(NAME_GameSession)) {
+		Sessions->DestroySession(NAME_GameSession);
+	}
+	HostSessions->DestroySession(NAME_GameSession);
+	HostSessions.Reset();
+	if (FOnlineSubsystemModule *OnlineModule = FModuleManager::GetModulePtr<FOnlineSubsystemModule>("OnlineSubsystem")) {
+		OnlineModule->DestroyOnlineSubsystem(InviteTestHostInstance);
+	}
+
+	if (!bWasLoggedIn) {
+		Identity->Logout(0);
+	}
+
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
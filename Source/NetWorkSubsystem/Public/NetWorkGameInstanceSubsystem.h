@@ -6,9 +6,80 @@
 #include "NetWorkSubsystem/Data/NetworkStructure.h"
 #include "Subsystems/GameInstanceSubsystem.h"
 #include "Interfaces/OnlineSessionInterface.h"
+#include "Interfaces/OnlineIdentityInterface.h"
+#include "Engine/EngineTypes.h"
+#include "GameFramework/OnlineReplStructs.h"
+#include "NetWorkSessionTrace.h"
+#include "NetWorkSessionSnapshot.h"
+#include "Containers/Ticker.h"
+#include "UObject/ObjectKey.h"
 #include "NetWorkSubsystem/Data/NetworkEnumeration.h"
 #include "NetWorkGameInstanceSubsystem.generated.h"
 
+//what a session operation was issued for, its completion is routed to the matching handler
+enum class ESessionRequestOwner : uint8 {
+	EHostGame,
+	EWarmPool,
+	EFindGames,
+	ESearchSource,
+	EJoinGame,
+	EUpdateSession,
+	//player count and match state update of the hosted session
+	EAdvertise,
+	ELeaveGame,
+	//destroy of the session a failed host or join left behind
+	EFailureCleanUp,
+};
+
+//one session operation waiting for its completion delegate
+struct FNetWorkSessionRequest {
+	ESessionStage Stage = ESessionStage::ECreate;
+	ESessionRequestOwner Owner = ESessionRequestOwner::EHostGame;
+	//session the operation is about, searches have none
+	FName SessionName;
+	//subsystem instance the operation runs on, None means the default one
+	FName SubsystemName;
+};
+
+//a session interface with the completion delegates of the subsystem registered on it
+struct FNetWorkBoundSessionInterface {
+	IOnlineSessionPtr Sessions;
+	FDelegateHandle CreateHandle;
+	FDelegateHandle StartHandle;
+	FDelegateHandle FindHandle;
+	FDelegateHandle JoinHandle;
+	FDelegateHandle UpdateHandle;
+	FDelegateHandle DestroyHandle;
+};
+
+//one session of the warm pool
+struct FNetWorkWarmSession {
+	FName SessionName;
+	bool bIsLAN = false;
+	//when CreateSession was issued
+	double RequestTime = 0.0;
+	//created and waiting to be handed out
+	bool bReady = false;
+};
+
+//measured size of a widget class, with the number of objects the measured widget owned
+struct FNetWorkWidgetSize {
+	int64 Bytes = 0;
+	//rows added to a list change this and the widget is measured again
+	int32 NumObjects = 0;
+};
+
+//one running or queued query of a multi-source search
+struct FNetWorkSearchSourceState {
+	FBlueprintSearchSource Source;
+	//subsystem instance the query runs on
+	FName SubsystemName;
+	TSharedPtr<class FOnlineSessionSearch> Search;
+	double StartTime = 0.0;
+	bool bStarted = false;
+	bool bFinished = false;
+};
+
 /**
  * 
  */
@@ -21,6 +92,10 @@ public:
 	UNetWorkGameInstanceSubsystem(const FObjectInitializer& ObjectInitializer);
 
 	virtual void Init();
+
+	//USubsystem
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
 	/* Widget references */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "State Manager")
 	TSubclassOf<class UUserWidget> cMainMenu;
@@ -33,6 +108,29 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "State Manager")
 	TSubclassOf<class UUserWidget> cLoadingScreen;
 
+	/* WIDGET PRELOADING */
+	//build the widgets of the likely next states in the background so switching screens does not wait on construction
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "State Manager")
+	bool bPreloadNextStateWidgets = true;
+
+	//likely next states for each state, edit to match the menu flow of the game
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "State Manager")
+	TMap<EGameState, FBlueprintStateTransitions> StateTransitions;
+
+	//most widgets kept preloaded at once
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "State Manager")
+	int32 MaxPreloadedWidgets = 3;
+
+	//frames that already took longer than this are not used for preloading
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "State Manager")
+	float WidgetPreloadMaxFrameMs = 33.0f;
+
+	//state changes that found their widget preloaded and ones that had to build it
+	UPROPERTY(BlueprintReadOnly, Category = "State Manager")
+	int32 WidgetPreloadHits;
+	UPROPERTY(BlueprintReadOnly, Category = "State Manager")
+	int32 WidgetPreloadMisses;
+
 	/* STATE CHANGES */
 	UFUNCTION(BlueprintCallable, Category = "Platformer Game Instance")
     void ChangeState(EGameState newState);
@@ -66,25 +164,67 @@ public:
 	//c++ function for hosting a session
 	bool HostSession(TSharedPtr<const FUniqueNetId> UserId, FName SessionName, bool bIsLAN, int32 MaxNumPlayers, TMap<FString, FOnlineSessionSetting> SettingsMap);
 
-	//delegate function which will be called when session is created
+	//called when the session created by HostSession is created
 	void OnCreateSessionComplete(FName SessionName, bool bWasSuccessful);
 
-	//delegate to be called when session is created
-	FOnCreateSessionCompleteDelegate OnCreateSessionCompleteDelegate;
+	/* WARM SESSION POOL */
+	//dedicated servers: keep sessions created and the map loaded ahead of HostGame, which then only has to start one
+	//a dedicated process hosts one match at a time, so one session is kept ready and a new one is made after the match
+	//can also be turned on with -WarmSessionPool on the command line
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session Management")
+	bool bUseWarmSessionPool = false;
 
-	//delegate handle retained after registering delegate
-	FDelegateHandle OnCreateSessionCompleteDelegateHandle;
+	//settings the pooled sessions are created with, HostGame requests for the other kind of match are pool misses
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session Management")
+	bool bWarmPoolIsLAN = false;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session Management")
+	int32 WarmPoolMaxPlayers = 16;
 
-	/* STARTING A SESSION */
+	//map kept loaded in memory while the pool is active
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session Management")
+	FString WarmPoolMapName = FString("Map_SandBox");
 
-	//delegate function which will be called when session is started
-	void OnStartOnlineGameComplete(FName SessionName, bool bWasSuccessful);
+	//HostGame calls served from the pool and calls that had to create a session
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	int32 WarmPoolHits;
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	int32 WarmPoolMisses;
 
-	//delegate to be called when session is started
-	FOnStartSessionCompleteDelegate OnStartSessionCompleteDelegate;
+	//time from issuing CreateSession for a pooled session until it was ready
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	float LastWarmSessionTimeToReadyMs;
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	float AverageWarmSessionTimeToReadyMs;
+
+	//start filling the pool and preloading the map
+	UFUNCTION(BlueprintCallable, Category = "Session Management")
+	void StartWarmSessionPool();
+
+	//destroy the sessions that were not handed out and release the map
+	UFUNCTION(BlueprintCallable, Category = "Session Management")
+	void StopWarmSessionPool();
 
-	//delegate handle retained after registering delegate
-	FDelegateHandle OnStartSessionCompleteDelegateHandle;
+	//hits / (hits + misses), 0 before the first HostGame
+	UFUNCTION(BlueprintPure, Category = "Session Management")
+	float GetWarmPoolHitRate();
+
+	//sessions created and waiting to be handed out
+	UFUNCTION(BlueprintPure, Category = "Session Management")
+	int32 GetNumReadyWarmSessions();
+
+	//called when a pooled session is created
+	void OnWarmSessionCreated(FName SessionName, bool bWasSuccessful);
+
+	//called when a pooled session handed to HostGame has the match settings applied
+	void OnWarmSessionUpdated(FName SessionName, bool bWasSuccessful);
+
+	//called when the session left behind by a failed host or join is destroyed
+	void OnFailedSessionDestroyed(FName SessionName, bool bWasSuccessful);
+
+	/* STARTING A SESSION */
+
+	//called when the hosted session is started
+	void OnStartOnlineGameComplete(FName SessionName, bool bWasSuccessful);
 
 	/* FINDING SESSIONS */
 
@@ -108,14 +248,29 @@ public:
 	//c++ function for finding sessions
 	void FindSessions(TSharedPtr<const FUniqueNetId> UserId, FName SessionName, bool bIsLAN);
 
-	//delegate function called when FindSessions completes
+	//called when the search started by FindSessions completes
 	void OnFindSessionsComplete(bool bWasSuccessful);
 
-	//Delegate for OnFindSessionsComplete
-	FOnFindSessionsCompleteDelegate OnFindSessionsCompleteDelegate;
+	/* MULTI-SOURCE SEARCH */
+	//online subsystem instance used for LAN queries by FindGamesMultiSource, None means "<default subsystem>:LANSearch"
+	//a separate instance lets the LAN query run at the same time as the online one
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session Management")
+	FName LANSearchSubsystemName;
 
-	//delegate handle for OnFindSessionsComplete
-	FDelegateHandle OnFindSessionsCompleteDelegateHandle;
+	//per-source outcome and latency of the last multi-source search
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	TArray<FBlueprintSearchSourceReport> searchSourceReports;
+
+	//blueprint function for searching LAN and online at the same time
+	UFUNCTION(BlueprintCallable, Category = "Session Management")
+	void FindGamesMultiSource(bool bIncludeLAN, bool bIncludeOnline);
+
+	//run all given query presets, searchResults is filled and de-duplicated as each source answers
+	UFUNCTION(BlueprintCallable, Category = "Session Management")
+	void FindGamesFromSources(TArray<FBlueprintSearchSource> Sources);
+
+	//called when a multi-source query on SubsystemName completes
+	void OnSearchSourceComplete(bool bWasSuccessful, FName SubsystemName);
 
 
 	/* JOIN SESSIONS */
@@ -126,14 +281,32 @@ public:
 	//c++ function for joining the session
 	bool JoinSession(TSharedPtr<const FUniqueNetId> UserId, FName SessionName, const FOnlineSessionSearchResult& SearchResult);
 
-	//delegate function which will be called when a session has been joined
+	//called when the session has been joined
 	void OnJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result);
 
-	//delegate for binding our function
-	FOnJoinSessionCompleteDelegate OnJoinSessionCompleteDelegate;
+	/* INVITES AND JOIN VIA PRESENCE */
+	//delegate function called when the player accepts a session invite or joins a friend from the platform overlay
+	void OnSessionUserInviteAccepted(const bool bWasSuccessful, const int32 ControllerId, FUniqueNetIdPtr UserId, const FOnlineSessionSearchResult& InviteResult);
+
+	//delegate handle for OnSessionUserInviteAccepted
+	FDelegateHandle OnSessionUserInviteAcceptedDelegateHandle;
 
-	//delegate handle for OnJoinSessionCompleteDelegate
-	FDelegateHandle OnJoinSessionCompleteDelegateHandle;
+	//Blueprint function for joining the session a friend is playing in without searching for games
+	UFUNCTION(BlueprintCallable, Category = "Session Management")
+	void JoinFriendGame(FUniqueNetIdRepl FriendId);
+
+	//delegate function called when the friend's session has been looked up
+	void OnFindFriendSessionComplete(int32 LocalUserNum, bool bWasSuccessful, const TArray<FOnlineSessionSearchResult>& SearchResults);
+
+	//delegate handle for OnFindFriendSessionComplete, registered for the lifetime of the subsystem
+	FDelegateHandle OnFindFriendSessionCompleteDelegateHandle;
+
+	//join the given session straight away, skipping the menu states
+	void FastJoinSession(const FOnlineSessionSearchResult& SearchResult);
+
+	//time from accepting the last invite or presence join to travelling, -1 until one has travelled
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	float LastInviteToTravelMs;
 
 	/* UPDATING SESSION */
 	//function for getting the current value of a special setting for the active session
@@ -145,31 +318,107 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Session Management")
 	void SetOrUpdateSessionSpecialSettingString(FBlueprintSessionSetting newSetting);
 
-	//delegate function which will be called after update session completes
+	//called when a settings or advertisement update of our session completes
 	void OnUpdateSessionComplete(FName SessionName, bool bWasSuccessful);
 
-	//delegate which will be called after updating a session
-	FOnUpdateSessionCompleteDelegate OnUpdateSessionCompleteDelegate;
+	/* ADVERTISING SESSION STATE */
+	//host only: keeps NumOpenPublicConnections and the "InProgress" setting of the hosted session up to date
 
-	//delegate handle for OnUpdateSessionCompleteDelegate
-	FDelegateHandle OnUpdateSessionCompleteDelegateHandle;
+	//minimum number of seconds between two advertisement updates sent to the backend
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session Management")
+	float AdvertiseMinUpdateInterval = 5.0f;
+
+	//player count changes smaller than this are held back until AdvertiseMaxStaleInterval has passed
+	//(becoming full or no longer full is always advertised)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session Management")
+	int32 AdvertisePlayerHysteresis = 2;
+
+	//longest time in seconds a held back player count change may wait before it is advertised anyway
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session Management")
+	float AdvertiseMaxStaleInterval = 30.0f;
+
+	//number of advertisement updates actually sent to the backend
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	int32 NumAdvertisementUpdatesSent;
+
+	//start publishing live player count and match state for the hosted session
+	void StartAdvertisingSession();
+
+	//stop publishing and unbind the game mode hooks
+	void StopAdvertisingSession();
+
+	//game mode hooks
+	void OnAdvertisedPlayerLogin(class AGameModeBase* GameMode, class APlayerController* NewPlayer);
+	void OnAdvertisedPlayerLogout(class AGameModeBase* GameMode, class AController* Exiting);
+	void OnAdvertisedMatchStateSet(FName MatchState);
 
 	/* DESTROYING A SESSION / LEAVING GAME */
 	//Blueprint function for leaving game
 	UFUNCTION(BlueprintCallable, Category = "Session Management")
 	void LeaveGame();
 
-	//delegate function which will be called after leaving session
+	//called when the session left by LeaveGame is destroyed
 	void OnDestroySessionComplete(FName SessionName, bool bWasSuccessful);
 
-	//delegate which will be called after destroying a session
-	FOnDestroySessionCompleteDelegate OnDestroySessionCompleteDelegate;
-
-	//delegate handle for OnDestroySessionCompleteDelegate
-	FDelegateHandle OnDestroySessionCompleteDelegateHandle;
-
 	/* HANDLE NETWORK ERRORS */
 	void HandleNetworkError(UWorld *World, UNetDriver *NetDriver, ENetworkFailure::Type FailureType, const FString & ErrorString);
+	void HandleTravelError(UWorld *World, ETravelFailure::Type FailureType, const FString & ErrorString);
+
+	//handles for the engine's network and travel failure delegates, bound for the lifetime of the subsystem
+	FDelegateHandle networkFailureHandle;
+	FDelegateHandle travelFailureHandle;
+
+	/* SESSION STAGE DEADLINES */
+	//seconds each session operation may take before it is cancelled, 0 disables the deadline
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session Management")
+	TMap<ESessionStage, float> SessionStageTimeouts;
+
+	//how often each session operation ran into its deadline
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	TMap<ESessionStage, int32> SessionStageTimeoutCounts;
+
+	//operation that last failed or timed out and why
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	ESessionStage LastFailedSessionStage;
+	UPROPERTY(BlueprintReadOnly, Category = "Session Management")
+	FString LastSessionError;
+
+	/* SESSION TRACE */
+	//write the recorded session events to Saved/SessionTraces, returns the file name
+	//also available as the net.SessionTrace.Dump console command
+	UFUNCTION(BlueprintCallable, Category = "Session Management")
+	FString DumpSessionTrace();
+
+	//recorder of session calls, callbacks, state changes and network errors
+	FNetWorkSessionTrace& GetSessionTrace() { return sessionTrace; }
+
+	/* SESSION SNAPSHOT */
+	//latest session state, safe to call from any thread while the subsystem is alive
+	FNetWorkSessionSnapshot GetSessionSnapshot() const { return sessionSnapshot.Get(); }
+
+	//version of the latest snapshot, safe to call from any thread
+	uint64 GetSessionSnapshotVersion() const { return sessionSnapshot.GetVersion(); }
+
+	/* MEMORY REPORT */
+	//bytes currently held by search results, session settings, widgets, pending delegates and the trace
+	//also available as the net.SessionMemory.Report console command
+	UFUNCTION(BlueprintCallable, Category = "Session Management")
+	FBlueprintMemoryReport GetMemoryReport();
+
+	//write GetMemoryReport to the log
+	UFUNCTION(BlueprintCallable, Category = "Session Management")
+	void LogMemoryReport();
+
+	//start measuring the high-water mark again from the current footprint
+	UFUNCTION(BlueprintCallable, Category = "Session Management")
+	void ResetMemoryHighWater();
+
+	/* LIFECYCLE BENCHMARK */
+	//time the per-call bookkeeping of a session operation, the old lookup and delegate add/clear against
+	//the cached interface and request routing, returns the summary that is also logged
+	//also available as the net.SessionLifecycle.Bench console command
+	UFUNCTION(BlueprintCallable, Category = "Session Management")
+	FString RunLifecycleBenchmark(int32 Iterations = 100000);
 
 	private:
 	//currently displayed widget
@@ -182,6 +431,196 @@ public:
 	//function for leaving a state
 	void LeaveState();
 
+	/* WIDGET PRELOADING */
+	//widgets built ahead of time, not added to the viewport yet
+	UPROPERTY()
+	TArray<UUserWidget*> preloadedWidgets;
+	//widget classes wanted for the likely next states of the current state, most likely first
+	TArray<TSubclassOf<UUserWidget>> preloadQueue;
+	//frame the current state was entered on, that frame already paid for a widget
+	uint64 stateEnteredFrame;
+	FTSTicker::FDelegateHandle preloadTickerHandle;
+
+	//widget class shown in a state, null for states without a widget
+	TSubclassOf<UUserWidget> GetStateWidgetClass(EGameState State);
+	//take the preloaded widget of that class or build one now
+	UUserWidget* AcquireStateWidget(TSubclassOf<UUserWidget> WidgetClass);
+	//work out which widgets the new state wants preloaded and drop the others
+	void UpdateWidgetPreloadQueue();
+	//builds at most one widget per frame while the screen is idle
+	bool TickWidgetPreload(float DeltaTime);
+
+	//name of the session we are hosting or have joined, pooled sessions are not called GameSessionName
+	FName activeSessionName;
+
+	//session settings used for every hosted session
+	FOnlineSessionSettings MakeHostSessionSettings(bool bIsLAN, int32 MaxNumPlayers, const TMap<FString, FOnlineSessionSetting>& SettingsMap);
+
+	/* WARM SESSION POOL */
+	TArray<FNetWorkWarmSession> warmSessions;
+	//used to give every pooled session its own name
+	int32 warmSessionCounter;
+	//pooled sessions that became ready, for the average time to ready
+	int32 numWarmSessionsReady;
+	bool bWarmPoolActive;
+	//retry after a failed create
+	FTimerHandle warmPoolRetryHandle;
+	//keeps the preloaded map in memory
+	UPROPERTY()
+	class UPackage *warmMapPackage;
+
+	//create the pooled session unless there is one already or a match is being hosted
+	void RefillWarmPool();
+	//load WarmPoolMapName in the background
+	void PreloadWarmPoolMap();
+	//hand a ready session out to HostGame and start it, false on a pool miss
+	bool TryHostFromWarmPool(bool bIsLAN, int32 MaxNumPlayers, const TMap<FString, FOnlineSessionSetting>& SettingsMap);
+	//points the game session of a loaded map at the session we host
+	FDelegateHandle postLoadMapHandle;
+	void OnPostLoadMap(UWorld* LoadedWorld);
+
+	//start the session we host once it is created, or once a pooled one has its settings
+	void StartHostedSession(FName SessionName);
+
+	/* INTERFACES AND REQUEST ROUTING */
+	//session interfaces with our completion delegates registered, by subsystem instance, None is the default one
+	TMap<FName, FNetWorkBoundSessionInterface> boundSessionInterfaces;
+	//identity interface of the default subsystem
+	IOnlineIdentityPtr cachedIdentity;
+	//issued session operations waiting for their completion, oldest first
+	TArray<FNetWorkSessionRequest> pendingSessionRequests;
+
+	//session interface of a subsystem instance, our completion delegates are registered the first time it is used
+	IOnlineSessionPtr GetSessions(FName SubsystemName = NAME_None);
+	//local player 0 of the default subsystem
+	FUniqueNetIdPtr GetLocalPlayerId();
+	//remove our delegates from every interface we registered them on
+	void UnbindSessionInterfaces();
+
+	//remember an operation before issuing it, the completion may fire from inside the call
+	void AddSessionRequest(ESessionStage Stage, ESessionRequestOwner Owner, FName SessionName, FName SubsystemName);
+	//forget a matching operation, used when the interface rejected the call
+	void RemoveSessionRequest(ESessionStage Stage, FName SessionName, FName SubsystemName);
+	//forget every operation of a stage issued by an owner, their late completions are ignored, the trace shows them as cancelled
+	void CancelSessionRequests(ESessionStage Stage, ESessionRequestOwner Owner);
+	//cancel the searches of an owner, the native queries included so they do not keep their instance busy
+	void CancelSearchRequests(ESessionRequestOwner Owner);
+	//find and remove the operation a completion belongs to
+	bool TakeSessionRequest(ESessionStage Stage, FName SessionName, FName SubsystemName, FNetWorkSessionRequest& OutRequest);
+
+	//completion delegates registered on every bound interface, they route to the handler of the request
+	void HandleCreateSessionComplete(FName SessionName, bool bWasSuccessful, FName SubsystemName);
+	void HandleStartSessionComplete(FName SessionName, bool bWasSuccessful, FName SubsystemName);
+	void HandleFindSessionsComplete(bool bWasSuccessful, FName SubsystemName);
+	void HandleJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result, FName SubsystemName);
+	void HandleUpdateSessionComplete(FName SessionName, bool bWasSuccessful, FName SubsystemName);
+	void HandleDestroySessionComplete(FName SessionName, bool bWasSuccessful, FName SubsystemName);
+
+	/* INVITES AND JOIN VIA PRESENCE */
+	//true while JoinFriendGame waits for the friend's session
+	bool bFindingFriendSession;
+	//when the pending fast join was accepted, 0 when there is none
+	double inviteAcceptedTime;
+	//session to join once the one we are in has been destroyed
+	TOptional<FOnlineSessionSearchResult> pendingFastJoin;
+
+	/* SESSION STAGE DEADLINES */
+	//one deadline timer per ESessionStage
+	FTimerHandle stageDeadlineHandles[(int32)ESessionStage::EDestroy + 1];
+
+	//start the deadline of a session operation that has just been issued
+	void ArmStageDeadline(ESessionStage Stage);
+	//the operation completed in time
+	void DisarmStageDeadline(ESessionStage Stage);
+	//timer callback
+	void OnStageDeadline(ESessionStage Stage);
+	//cancel a failed or timed out operation, clean up its delegate handle and move to the error state
+	void FailSessionStage(ESessionStage Stage, const FString& Reason);
+
+	/* SESSION TRACE */
+	FNetWorkSessionTrace sessionTrace;
+
+	/* SESSION SNAPSHOT */
+	FNetWorkSessionSnapshotPublisher sessionSnapshot;
+
+	//build a snapshot from the game thread state and publish it
+	void PublishSessionSnapshot();
+
+	/* MEMORY REPORT */
+	//largest footprint measured so far
+	int64 memoryHighWaterBytes;
+
+	//measure the footprint after it may have grown and raise the high-water mark
+	void UpdateMemoryHighWater();
+
+	//measured sizes of widget instances by class and of the widget classes themselves
+	TMap<TObjectKey<UClass>, FNetWorkWidgetSize> widgetSizeByClass;
+	TMap<TObjectKey<UClass>, int64> widgetClassSizes;
+
+	//size of a widget and everything it owns, measured again only when the number of objects it owns changed
+	int64 GetCachedWidgetSize(class UUserWidget* Widget);
+	//size of a widget class, measured once
+	int64 GetCachedWidgetClassSize(UClass* WidgetClass);
+
+	//record a session operation being issued
+	void TraceSessionCall(ESessionStage Stage);
+	//record the call being rejected and forget its request, unless its completion already fired inside the call
+	void TraceSessionCallResult(ESessionStage Stage, bool bAccepted, FName SessionName, FName SubsystemName);
+	//record a session completion delegate firing
+	void TraceSessionCallback(ESessionStage Stage, bool bWasSuccessful, int32 Detail = 0);
+
+	/* MULTI-SOURCE SEARCH */
+	//running and queued queries of the multi-source search
+	TArray<FNetWorkSearchSourceState> searchSources;
+	//index into searchResults by session id, used for de-duplication
+	TMap<FString, int32> searchResultIndexById;
+	//subsystem instance holding our joined session, None means the default one
+	FName sessionSubsystemName;
+
+	//start every queued query whose subsystem instance is idle
+	void StartPendingSearchSources();
+	//merge the results of a finished query into searchResults
+	void MergeSearchSourceResults(int32 SourceIndex, bool bWasSuccessful);
+
+	/* ADVERTISING SESSION STATE */
+	//players currently logged in to the hosted game
+	TSet<TWeakObjectPtr<class AController>> advertisedPlayers;
+	//live match state of the hosted game
+	bool bAdvertisedInProgress;
+	//values the backend last accepted
+	int32 publishedPlayerCount;
+	bool bPublishedInProgress;
+	//values of the update waiting for OnAdvertisementUpdated
+	int32 sentPlayerCount;
+	bool bSentInProgress;
+	//time of the last update sent to the backend
+	double lastAdvertiseTime;
+	//true while advertising is active
+	bool bIsAdvertising;
+	//true while an advertisement update is waiting for OnAdvertisementUpdated
+	bool bAdvertiseUpdateInFlight;
+	//timer used to send a held back update later
+	FTimerHandle advertiseTimerHandle;
+	//deadline of the update in flight, kept apart from the EUpdate stage so a timeout does not fail the session settings update
+	FTimerHandle advertiseDeadlineHandle;
+	//handles for the game mode hooks
+	FDelegateHandle advertiseLoginHandle;
+	FDelegateHandle advertiseLogoutHandle;
+	FDelegateHandle advertiseMatchStateHandle;
+
+	//number of players currently logged in
+	int32 GetLivePlayerCount();
+	//decide whether the live values should be sent now, later or not at all
+	void RequestAdvertisementUpdate();
+	//send the live values to the backend
+	void PublishAdvertisement();
+	//send the live values again after a failed update
+	void RetryAdvertisementUpdate();
+	//called when an advertisement update completes
+	void OnAdvertisementUpdated(FName SessionName, bool bWasSuccessful);
+	//timer callback, the advertisement update did not complete in time
+	void OnAdvertiseDeadline();
+
 	UFUNCTION(BlueprintCallable)
 	FString ReturnPath();
 };
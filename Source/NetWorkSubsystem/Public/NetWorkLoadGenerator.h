@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "Interfaces/OnlineSessionInterface.h"
+
+/* SETTINGS FOR ONE LOAD RUN */
+struct FNetWorkLoadSettings {
+	//number of simulated clients, each gets its own online subsystem instance
+	int32 NumClients = 8;
+	//find/join/leave cycles started per second across all clients
+	float CyclesPerSecond = 4.0f;
+	//seconds to run, 0 runs until stopped
+	float Duration = 60.0f;
+	//seconds before an operation that never completes is counted as an error
+	float OperationTimeout = 10.0f;
+	//search LAN (OnlineSubsystemNull) or online sessions
+	bool bIsLAN = true;
+	//also host a session on a separate instance instead of relying on a host that is already running
+	bool bHostSession = true;
+	//subsystem the client instances are created from
+	FName SubsystemName = FName("NULL");
+};
+
+/**
+ * Capacity test harness for the host/find/join flow.
+ * Creates NumClients independent session interfaces in this process ("<Subsystem>:LoadGenClient<N>"),
+ * and has them repeatedly find the local host, join it and leave again at the configured rate.
+ * Throughput, error rate and latency percentiles are logged when the run ends or on demand.
+ *
+ * net.LoadGen.Start [Clients=N] [Rate=R] [Duration=S] [Timeout=S] [LAN=0|1] [Host=0|1] [Subsystem=Name]
+ * net.LoadGen.Stop
+ * net.LoadGen.Report
+ */
+class NETWORKSUBSYSTEM_API FNetWorkLoadGenerator
+{
+public:
+	FNetWorkLoadGenerator();
+	~FNetWorkLoadGenerator();
+
+	//create the clients (and the host) and start cycling
+	bool Start(const FNetWorkLoadSettings& InSettings);
+
+	//stop cycling, log the report and tear the clients down
+	void Stop();
+
+	bool IsRunning() const { return bRunning; }
+
+	//log throughput, error rate and latency percentiles gathered so far
+	void LogReport() const;
+
+	//stop and free the generator of the net.LoadGen console commands, called from ShutdownModule
+	//while the online modules it uses are still loaded
+	static void ShutdownConsoleGenerator();
+
+private:
+	//where a simulated client is in its cycle
+	enum class EClientStep : uint8 {
+		EIdle,
+		EFinding,
+		EJoining,
+		ELeaving,
+	};
+
+	struct FClient {
+		FName InstanceName;
+		IOnlineSessionPtr Sessions;
+		TSharedPtr<class FOnlineSessionSearch> Search;
+		EClientStep Step = EClientStep::EIdle;
+		//when the current step and the current cycle started
+		double StepStartTime = 0.0;
+		double CycleStartTime = 0.0;
+		//a step of the current cycle failed but the cycle carries on to clean up
+		bool bCycleFailed = false;
+		FDelegateHandle FindHandle;
+		FDelegateHandle JoinHandle;
+		FDelegateHandle DestroyHandle;
+	};
+
+	//latencies in milliseconds and error counts for one kind of operation
+	struct FOperationStats {
+		TArray<float> LatenciesMs;
+		int32 Errors = 0;
+	};
+
+	bool Tick(float DeltaTime);
+
+	//step one client forward
+	void StartCycle(int32 ClientIndex);
+	void OnFindComplete(bool bWasSuccessful, int32 ClientIndex);
+	void OnJoinComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result, int32 ClientIndex);
+	void OnDestroyComplete(FName SessionName, bool bWasSuccessful, int32 ClientIndex);
+
+	//record the finished step and move on
+	void FinishStep(int32 ClientIndex, FOperationStats& Stats, bool bWasSuccessful);
+	void FailCycle(int32 ClientIndex, FOperationStats& Stats);
+
+	//host side
+	bool CreateHost();
+	void DestroyHost();
+
+	static void LogStats(const TCHAR* Name, const FOperationStats& Stats);
+
+	FNetWorkLoadSettings Settings;
+	TArray<FClient> Clients;
+
+	FOperationStats FindStats;
+	FOperationStats JoinStats;
+	FOperationStats LeaveStats;
+	FOperationStats CycleStats;
+
+	//instance hosting the session when bHostSession is set
+	FName HostInstanceName;
+	IOnlineSessionPtr HostSessions;
+
+	FTSTicker::FDelegateHandle TickerHandle;
+	bool bRunning;
+	double StartTime;
+	double StopTime;
+	//fractional cycles owed to the rate limiter
+	double CycleBudget;
+	int32 NextClient;
+};
@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/OnlineSessionInterface.h"
+
+/**
+ * Decorator around the IOnlineSession calls used by this plugin that emulates a slow or unreliable backend.
+ * Controlled by console variables, a pass-through while net.SessionEmu.Enable is 0:
+ *
+ * net.SessionEmu.Enable            turn emulation on
+ * net.SessionEmu.LatencyMs         delay before a call reaches the session interface
+ * net.SessionEmu.JitterMs          random extra delay, 0..JitterMs
+ * net.SessionEmu.FailureRate       chance 0..1 that a call fails asynchronously instead of reaching the interface
+ * net.SessionEmu.ResultInflation   every search result is reported this many times (see InflateSearchResults)
+ *
+ * A delayed or failed call returns true like an accepted call would, and its result arrives through the
+ * interface's normal completion delegates, so callers keep their existing delegate handling.
+ */
+class NETWORKSUBSYSTEM_API FNetWorkSessionEmulator
+{
+public:
+	explicit FNetWorkSessionEmulator(IOnlineSessionPtr InSessions);
+
+	bool CreateSession(const FUniqueNetId& HostingPlayerId, FName SessionName, const FOnlineSessionSettings& NewSessionSettings);
+	bool CreateSession(int32 HostingPlayerNum, FName SessionName, const FOnlineSessionSettings& NewSessionSettings);
+	bool StartSession(FName SessionName);
+	bool FindSessions(const FUniqueNetId& SearchingPlayerId, const TSharedRef<FOnlineSessionSearch>& SearchSettings);
+	bool FindSessions(int32 SearchingPlayerNum, const TSharedRef<FOnlineSessionSearch>& SearchSettings);
+	bool JoinSession(const FUniqueNetId& PlayerId, FName SessionName, const FOnlineSessionSearchResult& DesiredSession);
+	bool JoinSession(int32 PlayerNum, FName SessionName, const FOnlineSessionSearchResult& DesiredSession);
+	bool UpdateSession(FName SessionName, FOnlineSessionSettings& UpdatedSessionSettings, bool bShouldRefreshOnlineData = true);
+	bool DestroySession(FName SessionName);
+
+	//repeat every result of a finished search net.SessionEmu.ResultInflation times, call before reading SearchResults
+	static void InflateSearchResults(FOnlineSessionSearch& Search);
+
+	static bool IsEnabled();
+
+private:
+	//run Call after the emulated latency, or report failure through Fail instead
+	bool Emulate(TFunction<bool()>&& Call, TFunction<void()>&& Fail);
+
+	IOnlineSessionPtr Sessions;
+};
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NetWorkSubsystem/Data/NetworkEnumeration.h"
+#include <atomic>
+
+/* ONE PUBLISHED VIEW OF THE SESSION, NEVER CHANGED AFTER PUBLISHING */
+struct FNetWorkSessionSnapshot {
+	//increases by one with every publish, 0 before the first one
+	uint64 Version = 0;
+	//FPlatformTime::Seconds() when it was published
+	double PublishTime = 0.0;
+
+	EGameState GameState = EGameState::ENone;
+
+	//session we are hosting or have joined, None when not in a session
+	FName SessionName;
+	bool bIsHosting = false;
+	bool bIsLAN = false;
+	//the match has started
+	bool bIsInProgress = false;
+
+	int32 NumPlayers = 0;
+	int32 MaxPlayers = 0;
+	int32 NumOpenPublicConnections = 0;
+
+	//special settings of the session, as strings
+	TMap<FName, FString> Settings;
+
+	//state of the search menu
+	bool bSearchingForGames = false;
+	int32 NumSearchResults = 0;
+};
+
+/**
+ * Publishes immutable session snapshots from the game thread for readers on any thread.
+ * Publishing swaps an atomic pointer to a new snapshot (read-copy-update), readers never lock and never wait for the game thread.
+ * A replaced snapshot is freed once no reader was active after the swap, until then it stays on a retired list.
+ */
+class NETWORKSUBSYSTEM_API FNetWorkSessionSnapshotPublisher
+{
+public:
+	FNetWorkSessionSnapshotPublisher();
+	~FNetWorkSessionSnapshotPublisher();
+
+	FNetWorkSessionSnapshotPublisher(const FNetWorkSessionSnapshotPublisher&) = delete;
+	FNetWorkSessionSnapshotPublisher& operator=(const FNetWorkSessionSnapshotPublisher&) = delete;
+
+	//game thread only, Version and PublishTime are filled in here
+	void Publish(FNetWorkSessionSnapshot&& Snapshot);
+
+	//any thread, copy of the latest snapshot
+	FNetWorkSessionSnapshot Get() const;
+
+	//any thread, cheap check whether Get would return something new
+	uint64 GetVersion() const { return PublishedVersion.load(std::memory_order_acquire); }
+
+private:
+	//free retired snapshots if no reader can still see them
+	void Reclaim();
+
+	std::atomic<const FNetWorkSessionSnapshot*> Current;
+	//readers between loading Current and finishing their copy
+	mutable std::atomic<int32> ActiveReaders;
+	std::atomic<uint64> PublishedVersion;
+
+	//replaced snapshots waiting to be freed, game thread only
+	TArray<const FNetWorkSessionSnapshot*> Retired;
+};
@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NetWorkSubsystem/Data/NetworkEnumeration.h"
+
+/* KINDS OF TRACED EVENTS */
+enum class ENetWorkTraceEventType : uint8 {
+	//a session operation is about to be issued, Code is the ESessionStage, Result is 1 (0 in traces of older builds, for a rejected call)
+	ESessionCall,
+	//a session completion delegate fired, Code is the ESessionStage, Result is 1 on success, Detail is the raw result code or result count
+	ESessionCallback,
+	//ChangeState was called, Code is the requested EGameState, Detail is the state we came from
+	EStateChange,
+	//EnterState, Code is the EGameState
+	EStateEnter,
+	//LeaveState, Code is the EGameState being left
+	EStateLeave,
+	//HandleNetworkError or HandleTravelError, Code is 0 for a network failure and 1 for a travel failure,
+	//Detail is the ENetworkFailure::Type or ETravelFailure::Type
+	ENetworkError,
+	//a recorded session call ended without its completion delegate, Code is the ESessionStage, Detail is the ENetWorkTraceAbandonReason
+	ESessionAbandoned,
+};
+
+/* WHY A SESSION CALL ENDED WITHOUT A COMPLETION */
+enum class ENetWorkTraceAbandonReason : uint8 {
+	//the session interface returned false
+	ERejected,
+	//the stage deadline ran out before the completion
+	ETimedOut,
+	//a failure or a new request dropped the call, its completion is ignored
+	ECancelled,
+};
+
+/* ONE TRACED EVENT, KEPT AT 16 BYTES */
+struct FNetWorkTraceEvent {
+	//FPlatformTime::Cycles64() when the event was recorded
+	uint64 Cycles;
+	//ENetWorkTraceEventType
+	uint8 Type;
+	//ESessionStage or EGameState depending on Type
+	uint8 Code;
+	//success flag or result code depending on Type
+	uint8 Result;
+	uint8 Padding;
+	//extra data depending on Type (result count, previous state, failure type)
+	int32 Detail;
+};
+
+/**
+ * Fixed size ring buffer of session events.
+ * Recording only fills a preallocated slot on the game thread, older events are overwritten once the buffer is full.
+ * The buffer can be written to a compact binary file which NetWorkSessionTraceCommandlet replays or summarises.
+ */
+class NETWORKSUBSYSTEM_API FNetWorkSessionTrace
+{
+public:
+	FNetWorkSessionTrace();
+
+	//record one event, does nothing while net.SessionTrace.Enable is 0
+	void Record(ENetWorkTraceEventType Type, uint8 Code, uint8 Result = 0, int32 Detail = 0);
+
+	//write the buffered events, oldest first, to Saved/SessionTraces and return the file name (empty on failure)
+	FString Dump(const FString& Reason);
+
+	//same as Dump but only if net.SessionTrace.DumpOnError is set and no error trace was written within
+	//net.SessionTrace.DumpOnErrorInterval, used by the failure paths
+	void DumpOnError(const FString& Reason);
+
+	//copy the buffered events, oldest first
+	void GetEvents(TArray<FNetWorkTraceEvent>& OutEvents) const;
+
+	//drop all buffered events
+	void Reset();
+
+	//bytes held by the ring buffer
+	SIZE_T GetAllocatedSize() const { return Events.GetAllocatedSize(); }
+
+	//read a file written by Dump
+	static bool LoadFromFile(const FString& FileName, TArray<FNetWorkTraceEvent>& OutEvents, double& OutSecondsPerCycle, FString& OutReason);
+
+	//readable names used by the commandlet and log output
+	static const TCHAR* GetEventTypeName(uint8 Type);
+	static const TCHAR* GetStageName(uint8 Stage);
+	static const TCHAR* GetAbandonReasonName(uint8 Reason);
+	static const TCHAR* GetStateName(uint8 State);
+
+private:
+	//ring storage, allocated on first record
+	TArray<FNetWorkTraceEvent> Events;
+	//next slot to write
+	int32 Head;
+	//events recorded since the last reset, may be larger than the buffer
+	uint64 NumRecorded;
+	//FPlatformTime::Seconds() of the last DumpOnError that wrote a file
+	double LastErrorDumpTime;
+
+	//keep at most net.SessionTrace.MaxFiles traces in Saved/SessionTraces
+	static void DeleteOldTraceFiles();
+};
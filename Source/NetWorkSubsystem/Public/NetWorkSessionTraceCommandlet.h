@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "NetWorkSessionTraceCommandlet.generated.h"
+
+/**
+ * Offline analysis of session traces written by FNetWorkSessionTrace.
+ *
+ * -run=NetWorkSessionTrace -Trace=<file>   use the given trace, defaults to the newest file in Saved/SessionTraces
+ * -Replay                                   print every event in order with its time since the first event
+ * -Summary                                  print per-stage timelines and state durations (default)
+ */
+UCLASS()
+class NETWORKSUBSYSTEM_API UNetWorkSessionTraceCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+public:
+	//Constructor
+	UNetWorkSessionTraceCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	//print every event in order
+	void Replay(const TArray<struct FNetWorkTraceEvent>& Events, double SecondsPerCycle);
+	//print call to callback timelines per stage and time spent in each state
+	void Summarise(const TArray<struct FNetWorkTraceEvent>& Events, double SecondsPerCycle);
+};
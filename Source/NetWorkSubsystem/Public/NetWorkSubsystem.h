@@ -4,6 +4,16 @@
 
 #include "CoreMinimal.h"
 #include "Modules/ModuleManager.h"
+#include "HAL/LowLevelMemTracker.h"
+
+NETWORKSUBSYSTEM_API DECLARE_LOG_CATEGORY_EXTERN(LogNetWorkSubsystem, Log, All);
+
+//Low Level Memory tags, visible with -llm in stat LLMFULL and LLM csv captures
+LLM_DECLARE_TAG_API(NetWorkSubsystem, NETWORKSUBSYSTEM_API);
+LLM_DECLARE_TAG_API(NetWorkSubsystem_SearchResults, NETWORKSUBSYSTEM_API);
+LLM_DECLARE_TAG_API(NetWorkSubsystem_SessionSettings, NETWORKSUBSYSTEM_API);
+LLM_DECLARE_TAG_API(NetWorkSubsystem_Widgets, NETWORKSUBSYSTEM_API);
+LLM_DECLARE_TAG_API(NetWorkSubsystem_Trace, NETWORKSUBSYSTEM_API);
 
 class FNetWorkSubsystemModule : public IModuleInterface
 {